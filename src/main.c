@@ -4,14 +4,45 @@
  * 2. 编译环境：VSCode + SDCC/STC官方编译器
  * 3. 功能描述：
  *    - 基于2410s（P3.2）和PIR（P3.3）双人体传感器检测人员状态，P3.3上升沿中断唤醒掉电模式
- *    - 集成CH15通道LVD+ADC电压检测
+ *    - 集成CH15通道LVD+ADC电压检测（LVD优先：LVD未触发即判定电压高，ADC仅在遥测到期或LVD状态变化时上电）；电源分档管理：正常 / 节能（<3.0V，仅PIR检测，不做再入学习）/
+ *      危急（<2.8V，切断传感器电源、停止串口输出），LVD按下一档布防（正常档不高于阈值的档位→节能，节能档2.7V→危急）立即降档
  *    - P3.3中断防重复触发机制：唤醒后屏蔽中断，掉电前恢复中断
- *    - 核心计时逻辑：唤醒后P5.5置低→延时0.5s→检测电压 → 标记电压高/低（调试模式串口输出）
- *    - 精准控制HMBC09P芯片的Key1/Key2/Key3输出指定时长低脉冲，LED1→Key1、LED2→Key2、Relay3→Key3
- *    - 低功耗设计：无人员活动时进入掉电模式，关闭MHCB09P和HLK2401电源，仅P3.3上升沿中断可唤醒
- *    - 看门狗功能：防止程序跑飞，溢出时间约1秒，主循环定期喂狗，掉电模式自动休眠
- *    - 调试模式：电源常开（P5.5初始低）+ 串口1初始化（115200波特率）+ 串口输出电压值；
- *    - 非调试模式：电源按逻辑控制（初始高）+ 不初始化串口 + 不输出电压值
+ *    - 核心计时逻辑：唤醒后P5.5置低→HMBC09P LED线稳定即开灯（Key1）→后台等待传感器就绪（2410s输出及LED线稳定，最长0.5s）→检测电压 → 标记电压高/低（调试模式串口输出）
+ *    - 精准控制HMBC09P芯片的Key1/Key2/Key3输出指定时长低脉冲，LED1→Key1、LED2→Key2、Relay3→Key3；
+ *      脉冲由PCA比较匹配中断定时结束（0.5us分辨率，不阻塞主循环），同一时刻只输出一个脉冲
+ *    - 联动通道描述表（chan_table）：每通道给出Key引脚、反馈引脚及极性、脉冲宽度参数和联动规则（占用/电压），
+ *      主循环逐通道执行，通道数CHAN_COUNT为编译期常量，封装引脚允许时增加表项即可扩展
+ *    - LED闪烁解码：Timer0采样时记录LED1~LED3状态线的边沿时刻，按边沿间隔分为常亮/常灭/慢闪/快闪；
+ *      HMBC09P配对/故障/确认期间LED闪烁（及单次跳变后未稳定）时联动规则保持现状，不输出Key脉冲
+ *    - 低功耗设计：无人员活动时进入掉电模式，关闭MHCB09P和HLK2401电源，仅P3.3上升沿中断可唤醒；
+ *      引脚配置表（pin_table）给出每个引脚的工作态/掉电态，掉电进入和唤醒时整体切换；
+ *      PIR唤醒须P3.3持续高电平20ms才打开传感器电源，误唤醒直接重新掉电并屏蔽INT1 2s
+ *    - 看门狗功能：WDT_CONTR溢出时间约2.1秒，各任务（输入/规则/脉冲）按时报到才喂狗，空闲模式继续计数，掉电模式停止计数
+ *    - 协作式调度器：软定时器按到期时刻排序（链表，Timer0 1ms节拍驱动），任务运行至结束不抢占；
+ *      看门狗监督、占用估计+联动规则为周期任务，脉冲结束记录、测压、掉电前延时为一次性任务，
+ *      统计各任务运行次数及耗时（串口命令A），无到期任务时进入空闲模式（PCON.IDL）等待下一个中断
+ *    - 负载及堆栈监测（调试模式）：启动时堆栈区涂色求高水位，按空闲模式时间每秒计算CPU忙碌百分比，
+ *      记录主循环单轮最长耗时；掉电前串口输出，串口命令C输出CPU/LOOPUS/STACK等字段
+ *    - 事件日志：唤醒/脉冲及反馈/电压/复位事件先暂存RAM，掉电前批量写入IAP EEPROM（4扇区轮换，序号防撕裂），串口命令J导出
+ *    - 人员占用估计：雷达（慢增长/快衰减，权重70%）与PIR（触发满值/慢衰减）证据融合为置信度，
+ *      有人最短保持5s + 无人确认3s，联动规则和掉电判断均基于融合后的占用状态
+ *    - 电池电量估计：滤波电压按放电曲线（分段线性）换算电量，按系统时钟（掉电定时唤醒计数）估计放电速率和剩余天数，
+ *      预计剩余不足3天即提前打开Relay3充电（持续到90%），串口命令C输出
+ *    - 无人确认时间自学习：掉电后15s内（掉电唤醒定时器）被PIR再次唤醒则延长2s，否则缩短0.25s，范围1~30s，
+ *      学习值保存在IAP设置扇区，统计再入次数及因延长而避免的掉电-唤醒次数
+ *    - 遥测串口（串口2，TxD2=P1.1，与下载/调试口分开，非调试模式同样输出）：每次唤醒结束掉电前输出一行TLM记录，
+ *      中断驱动发送，掉电前发送完毕并关闭串口2中断和波特率定时器
+ *    - 输入轨迹记录构建（TRACE_MODE）：Timer0每1ms采样PIR/雷达/LED/继电器反馈，边沿、唤醒及测压记录经遥测串口输出，
+ *      由tools/replay在主机上回放到各固件版本，比较唤醒次数、脉冲数、运行时间、能耗估计及唤醒到开灯延迟
+ *    - 串口控制台（调试模式/维护串口）：中断收发环形缓冲区，主循环后台解析命令（状态查询/参数读写/手动脉冲/计数器/对时/日志导出）
+ *    - 维护唤醒（MAINT_CONSOLE）：掉电期间RXD（P3.0，INT4）下降沿唤醒，只开串口1和控制台，传感器电源保持关闭，
+ *      连续30s无接收（或命令Q）后重新掉电；维护会话次数及时间与占用唤醒分开统计（串口命令C、遥测MNT）
+ *    - 中断剖析构建（PROFILE_MODE）：PCA常开作为自由计数器，统计各中断入口延迟、执行时间及Timer0节拍周期抖动，串口命令R输出
+ *    - 复位诊断：启动时捕获复位原因（上电/看门狗/低压/其他）并计数，扩展RAM末尾保留运行面包屑（热复位不清零）
+ *    - 快速冷启动：上电只配置掉电所需（IO/INT1/LVD/看门狗）即进入掉电，串口/ADC/PCA/设置读取及复位报告推迟到首次唤醒，
+ *      启动到首次掉电耗时记录在boot_us（串口命令C输出BOOTUS）
+ *    - 调试模式：电源常开（P5.5初始低）+ 串口1初始化（115200波特率）+ 串口输出电压值、复位原因；
+ *    - 非调试模式：电源按逻辑控制（初始高）+ 串口1仅用于维护控制台（MAINT_CONSOLE，注释则不初始化） + 不输出电压值
  * 4. IO口定义及模式：
  *    - 刷机/串口复用口：P3.1(TX1)、P3.0(RX1)（刷机时为下载口，运行时为串口1）
  *    - 输入口（高阻模式）：
@@ -28,41 +59,106 @@
  *      P5.4 - HMBC09P Key1输出（LED1联动）
  *      P1.7 - HMBC09P Key2输出（LED2联动）
  *      P1.5 - HMBC09P Key3输出（Relay3电压联动）
+ *      P1.1 - 遥测输出TxD2（准双向口，空闲高）
  * 5. 核心逻辑（V2.0 最终版）：
- *    - P3.3上升沿触发中断 → 置位唤醒标志 + 屏蔽INT1中断 → 退出掉电模式 → 打开电源 → 延时0.5s→检测电压 → 标记电压高/低
- *    - 循环：喂狗 → 如果LED1关闭 → Key1输出0.05s低脉冲
- *    - 执行逻辑：
- *      ① 有人（P3.2高）+ LED2关闭 → Key2输出0.05s低脉冲 
+ *    - P3.3上升沿触发中断 → 置位唤醒标志 + 屏蔽INT1中断 → 退出掉电模式 → 打开电源 → LED1未亮则立即Key1开灯
+ *      → 后台：等待就绪（≤0.5s）→检测电压 → 标记电压高/低
+ *    - 循环：喂狗 → 更新占用估计 → 如果有人且LED1关闭 → Key1输出0.05s低脉冲
+ *    - 执行逻辑（有人/无人取融合后的占用状态）：
+ *      ① 有人 + LED2关闭 → Key2输出0.05s低脉冲 
  *      ③ 电压低+Relay3关闭 → Key3输出0.05s低脉冲；电压高+Relay3打开 → Key3输出0.05s低脉冲
- *      ④ 无人（P3.2低）+ LED2打开 → Key2输出0.05s低脉冲→ 如果led1打开则Key1输出0.05s低脉冲；检查P3.2、P3.3是否为低：
- *         - 满足：延时1s→关闭电源+恢复INT1→关闭看门狗→掉电→ 跳出当前循环；
+ *      ④ 确认无人 → LED2打开则Key2输出0.05s低脉冲 → LED1打开则Key1输出0.05s低脉冲；检查P3.2、P3.3是否为低：
+ *         - 满足：延时1s→关闭电源+恢复INT1→喂狗→掉电→ 跳出当前循环；
  *         - 不满足：继续循环
  **************************************************************************************/
 #include <STC8G.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <stdio.h>  // 串口打印需要的头文件
 
 // ====================== 调试模式预定义开关（核心）======================
 #define DEBUG_MODE  // 调试模式开关：电源常开+串口输出；注释则关闭调试模式
+// #define PROFILE_MODE  // 中断剖析构建：PCA常开作为自由计数器，统计各中断入口延迟/执行时间及节拍抖动（须同时开启调试模式）
+// #define TRACE_MODE    // 输入轨迹记录构建：PIR/雷达/LED/继电器反馈边沿经遥测串口输出，供tools/replay回放比较各版本
+#define MAINT_CONSOLE // 维护串口：掉电期间RXD下降沿唤醒，仅开启串口1及控制台（不打开传感器电源）；注释则非调试模式不编译串口1
+#define VOLTAGE_MONITOR_LVD // 电压监测LVD优先：LVD未触发即判定电压高，ADC仅用于遥测/LVD变化；注释则每次唤醒ADC测压
 
 // 补充STC8G特殊功能寄存器定义
 #define _P1ASF 0x9D
 SFR(P1ASF, 0x9D);
-#define _LVDCR 0xFD
-SFR(LVDCR, 0xFD);
-// 看门狗寄存器定义（STC8G1K17）
-SFR(WDTCN, 0xE7); // 看门狗控制寄存器
+#define _IAP_TPS 0xF5
+SFR(IAP_TPS, 0xF5);  // IAP等待时间（STC8G：按系统时钟MHz数设置）
 
 /************************* 可配置参数区 *************************/
 // 时间参数（ms）
-#define DELAY_WAKEUP       500     // 唤醒后延时（0.5s）
+#define DELAY_WAKEUP       500     // 唤醒后就绪等待上限（0.5s）
+#define READY_MIN_MS       50      // 上电后最短等待（跳过电源上升期的毛刺）
+#define READY_STABLE_MS    100     // 雷达输出及LED状态线保持不变该时长即判定就绪
+#define LIGHT_READY_MIN_MS 10      // 快速开灯：上电后最短等待
+#define LIGHT_READY_STABLE_MS 20   // 快速开灯：LED状态线保持不变该时长即判定HMBC09P可接收按键
+#define LIGHT_READY_MAX_MS 150     // 快速开灯：最长等待
 #define DELAY_KEY_PULSE    50      // Key脉冲时长（0.05s）
+
+// Key脉冲硬件定时（全部通道共用PCA模块0，16位软件定时器模式，比较匹配中断结束脉冲）
+#define PCA_CLK_DIV        12      // PCA时钟 = SYSclk/12（CMOD.CPS=000），24MHz下2MHz，0.5us分辨率
+#define PCA_COUNTS_PER_MS  (FOSC / PCA_CLK_DIV / 1000)
+#define PCA_CCAPM_TIMER    (ECOM0 | MAT0 | ECCF0) // 比较匹配置CCFn并中断，不驱动CCP引脚
+// 联动通道（通道描述表chan_table：Key引脚、反馈引脚及极性、脉冲宽度参数、联动规则）
+#define CHAN_COUNT         3       // 通道数（编译期常量，按芯片封装可用引脚扩展）
+#define CHAN_LIGHT         0       // 唤醒快速开灯通道（Key1/LED1）
+#define CHAN_RULE_OCCUPANCY 0      // 有人→打开，确认无人→关闭
+#define CHAN_RULE_VOLTAGE  1       // 电压低或提前充电→打开，电压高→关闭（须本次唤醒已完成测压）
+#define CHAN_TARGET_OFF    0
+#define CHAN_TARGET_ON     1
+#define CHAN_TARGET_NONE   2       // 规则条件未满足，保持现状
+#define CHAN_LED_NONE      0xFF    // 反馈线不是LED状态线（不做闪烁解码）
+
+// LED状态线闪烁解码：LED线编号n对应LEDn+1（LED_LINES()的bit n）
+#define LED_LINE_COUNT     3
+#define LED_STEADY_MS      1200    // 超过该时间无边沿→常亮/常灭（须长于慢闪周期）
+#define LED_FAST_HALF_MS   250     // 最近半周期（相邻边沿间隔）短于该值→快闪，否则慢闪
+#define LED_STATE_OFF      0       // 常灭
+#define LED_STATE_ON       1       // 常亮
+#define LED_STATE_SLOW     2       // 慢闪（含单次跳变后未稳定）
+#define LED_STATE_FAST     3       // 快闪
 #define DELAY_POWER_OFF    1000    // 掉电前延时（1s）
-#define WDT_FEED_INTERVAL  500     // 看门狗喂狗间隔（0.5s，小于溢出时间）
+#define WDT_FEED_INTERVAL  500     // 看门狗监督检查间隔（0.5s，小于溢出时间）
+
+// 看门狗参数（WDT_CONTR）：溢出时间 = 12 × 32768 × 2^(WDT_PS+1) / FOSC
+#define WDT_PS             6       // 24MHz下约2.1s（覆盖任务报到截止时间1.5s）
+
+// 看门狗任务监督：各任务在截止时间内报到，全部正常时才喂狗
+#define WDT_TASK_INPUT     0       // 输入采样
+#define WDT_TASK_RULES     1       // 联动规则判断
+#define WDT_TASK_PULSE     2       // Key脉冲输出（仅脉冲期间受监督）
+#define WDT_TASK_COUNT     3
+
+// 协作式调度器：任务编号即软定时器下标；到期时刻取毫秒计时低16位，单次延时/周期须小于32.7s
+#define SCHED_TASK_WDT     0       // 看门狗监督（周期WDT_FEED_INTERVAL）
+#define SCHED_TASK_SENSE   1       // 占用估计+联动规则（周期OCC_STEP_MS）
+#define SCHED_TASK_PULSE   2       // Key脉冲结束记录（一次性，按脉宽安排，未结束则1ms后重试）
+#define SCHED_TASK_VOLT    3       // 后台测压（一次性，传感器就绪且ADC上电稳定后）
+#define SCHED_TASK_POWER_OFF 4     // 掉电前延时（一次性，掉电条件不再满足时取消）
+#ifdef DEBUG_MODE
+#define SCHED_TASK_LOAD    5       // CPU负载统计窗口（周期CPU_LOAD_WINDOW_MS，仅调试模式）
+#define SCHED_TASK_COUNT   6
+#else
+#define SCHED_TASK_COUNT   5
+#endif
+#define SCHED_NONE         0xFF    // 链表结束
+
+// 负载及堆栈监测（仅调试模式）
+#define CPU_LOAD_WINDOW_MS 1000    // CPU忙碌百分比统计窗口
+#define STACK_PAINT        0xA5    // 堆栈涂色值（8051堆栈自SP向上增长至内部RAM顶端0xFF）
 
 // 电压参数
-#define VOLTAGE_THRESHOLD  3000    // 电压阈值（3V，单位mV）
+#define VOLTAGE_THRESHOLD  3000    // 电压阈值（3V，单位mV），低于该值进入节能档
+#define POWER_CRITICAL_MV  2800    // 低于该值进入危急档（立即切断2410s/HMBC09P电源）
+#define POWER_HYSTERESIS_MV 100    // 升档回差（须高于阈值该值才恢复上一档）
+#define LVD_LEVEL_3V0      0x03    // RSTCFG.LVDS：3.0V低压检测档位（上电默认）
+#define LVD_LEVEL_CRITICAL 0x02    // 低于危急电压的最高LVD档位（2.7V）：节能档布防，触发→危急档
+#define LVD_LEVEL_MASK     0x03
+#define VOLT_TELEMETRY_S   3600    // LVD优先模式：遥测（电量估计）ADC采样间隔（1小时）
+#define ADC_SETTLE_MS      2       // ADC上电稳定时间
 #define REF_VOLTAGE        1190    // 内部参考电压（1.19V，可校准）
 
 // 硬件状态定义
@@ -76,9 +172,99 @@ SFR(WDTCN, 0xE7); // 看门狗控制寄存器
 #define TIMER0_PRESCALER   1       // 1T模式
 #define TIMER0_RELOAD      (65536 - (FOSC / 1000 / TIMER0_PRESCALER)) // 1ms重载值
 
-// 串口参数（115200波特率，24MHz晶振）
+// 中断优先级（IP/IPH组合为0~3级，3最高）及寄存器组（__using）
+// 每增加一组寄存器占用8字节直接寻址RAM（与__data变量、位寻址区、覆盖区及堆栈共用128字节），
+// 因此只有最高级、对释放沿时间最敏感的PCA中断使用独立寄存器组，其余中断按默认方式压栈
+//   3级：PCA（Key脉冲释放沿）         寄存器组1
+//   2级：Timer0（1ms节拍）            默认压栈
+//   1级：INT1（唤醒）、LVD（甩负载）   默认压栈
+//   0级：UART1、UART2、INT0            默认压栈
+#define ISR_BANK_PCA       1
+
+#if defined(PROFILE_MODE) && !defined(DEBUG_MODE)
+#error "PROFILE_MODE requires DEBUG_MODE (results are dumped over UART1)"
+#endif
+
+// 串口1及控制台：调试模式或维护串口开启时编译
+#if defined(DEBUG_MODE) || defined(MAINT_CONSOLE)
+#define CONSOLE_ENABLE
+#endif
+
+// 串口参数（115200波特率，24MHz晶振；串口1和串口2共用定时器2作为波特率发生器）
 #define BAUDRATE           115200
 
+// 遥测串口（串口2：RxD2=P1.0未用，TxD2=P1.1仅发送；与下载/调试口分开，非调试模式同样可用）
+#define TLM_TX_BUF_SIZE    64      // 遥测发送环形缓冲区（长度须为2的幂）
+
+// 输入轨迹记录（TRACE_MODE）：每行一条记录，格式见tools/replay/README.md
+//   W <系统时钟s> <1=确认唤醒/0=误唤醒>   E <唤醒后ms> <输入线位图>   V <唤醒后ms> <mV>   D <丢弃条数>
+#define TRACE_BUF_SIZE     16      // 记录环形缓冲区（长度须为2的幂）
+#define TRACE_EV_WAKE      'W'
+#define TRACE_EV_EDGE      'E'
+#define TRACE_EV_VOLT      'V'
+#define TRACE_EV_DROP      'D'
+
+// 事件日志参数（IAP EEPROM，需在烧录时分配不少于2.5KB的EEPROM空间：日志2KB+设置512B）
+#define JOURNAL_BASE_ADDR  0x0000  // 日志区起始IAP地址
+#define JOURNAL_SECTORS    4       // 轮换扇区数（磨损均衡）
+#define IAP_SECTOR_SIZE    512     // STC8G扇区大小（字节）
+#define IAP_MIN_MV         2400    // IAP擦写最低电压（mV，低于此值擦写可能失败或写坏扇区）
+#define JOURNAL_RAM_SIZE   16      // RAM暂存记录数（掉电前批量写入）
+#define JOURNAL_FLUSH_LEVEL 12     // 暂存达到该数量时在主循环空闲点写入
+
+// 设置存储参数（日志区之后单独一个扇区，4字节记录追加写，写满擦除）
+#define SETTINGS_ADDR      (JOURNAL_BASE_ADDR + (uint16_t)JOURNAL_SECTORS * IAP_SECTOR_SIZE)
+#define SETTINGS_REC_SIZE  4
+#define SETTING_ABSENCE_TIMEOUT 1  // 学习得到的无人确认时间（ms）
+
+// 无人确认时间自适应参数
+#define ADAPT_REENTRY_WINDOW_MS 15000   // 再入观察窗口：掉电后15s内被PIR唤醒视为再入
+#define ADAPT_MIN_MS            1000    // 学习下限（1s）
+#define ADAPT_MAX_MS            30000   // 学习上限（30s）
+#define ADAPT_STEP_UP_MS        2000    // 每次再入延长2s
+#define ADAPT_STEP_DOWN_MS      250     // 每次窗口内无再入缩短0.25s
+#define WKT_TICK_US             488     // 掉电唤醒定时器计数周期（内部32kHz/16，约488us）
+#define CLOCK_TICK_S            (ADAPT_REENTRY_WINDOW_MS / 1000) // 掉电期间每次定时唤醒计入的秒数
+#define WAKE_QUAL_MS            20      // PIR唤醒确认：P3.3须持续高电平的最短时间（真实触发输出保持数秒）
+#define WAKE_LOCKOUT_MS         2000    // 误唤醒后屏蔽INT1的时间（PIR恢复期/热扰动反复触发）
+
+// 电池电量估计参数（放电曲线见soc_curve_mv/soc_curve_pm，电量单位0.1%）
+#define SOC_CURVE_POINTS        7
+#define SOC_RATE_MIN_S          3600    // 放电速率估计最短间隔（1小时）
+#define SOC_RATE_WINDOW_S       21600   // 电量下降不足时最长6小时估计一次
+#define SOC_RATE_MIN_DROP       10      // 电量下降≥1.0%即可估计
+#define SOC_DAYS_UNKNOWN        0xFFFF  // 剩余天数未知（尚无放电速率）
+#define SOC_CHARGE_EARLY_DAYS   3       // 预计剩余天数少于3天 → 提前开始充电
+#define SOC_CHARGE_STOP_PM      900     // 提前充电持续到电量90%
+
+// 串口缓冲区参数（长度须为2的幂）
+#define UART_TX_BUF_SIZE   64      // 发送环形缓冲区
+#define UART_RX_BUF_SIZE   16      // 接收环形缓冲区
+#define CONSOLE_LINE_SIZE  20      // 命令行最大长度
+
+// 维护唤醒（RXD=P3.0兼作INT4，仅下降沿触发；唤醒字节本身丢失，上位机先发一个字节再等待MAINT提示）
+#define MAINT_IDLE_MS      30000   // 维护会话连续无接收超时（ms），超时后重新掉电
+
+// 运行时可调参数（串口命令P读写，默认值取自上面的宏）
+#define PARAM_VOLTAGE_THRESHOLD 0  // 电压阈值（mV）
+#define PARAM_DELAY_WAKEUP      1  // 唤醒后就绪等待上限（ms）
+#define PARAM_KEY_PULSE         2  // Key脉冲时长（ms）
+#define PARAM_POWER_OFF         3  // 掉电前延时（ms）
+#define PARAM_OCC_HOLD          4  // 有人状态最短保持时间（ms）
+#define PARAM_OCC_CONFIRM       5  // 无人确认窗口（ms）
+#define PARAM_COUNT             6
+
+// 人员占用估计参数（证据值0~100，每OCC_STEP_MS更新一步）
+#define OCC_STEP_MS             50      // 证据更新步长（ms）
+#define OCC_PIR_DECAY           2       // PIR证据每步衰减（满值约2.5s衰减到0）
+#define OCC_RADAR_RISE          5       // 雷达证据每步增长（约1s达到满值，滤除雷达短时误报）
+#define OCC_RADAR_DECAY         10      // 雷达证据每步衰减（约0.5s衰减到0）
+#define OCC_RADAR_WEIGHT        70      // 雷达证据权重（%），雷达单独最高贡献70
+#define OCC_ENTER_LEVEL         60      // 置信度≥该值 → 有人
+#define OCC_EXIT_LEVEL          20      // 置信度<该值持续确认窗口 → 无人
+#define OCC_HOLD_MS             5000    // 有人状态最短保持（5s）
+#define OCC_CONFIRM_MS          3000    // 无人确认窗口（3s）
+
 /************************* IO口定义 *************************/
 // 输入口（高阻模式）
 #define HUMAN_2410S_IN    P32     // 2410s人体检测
@@ -90,62 +276,653 @@ SFR(WDTCN, 0xE7); // 看门狗控制寄存器
 #define RELAY2_FEEDBACK   P37     // Relay2反馈（预留）
 #define RELAY3_FEEDBACK   P14     // Relay3反馈
 
-// 输出口（推挽模式）
+// 输出口（推挽模式）；Key输出及其反馈线见通道描述表chan_table
 #define POWER_CTRL        P55     // 电源控制（低电平开，高电平关）
-#define KEY1_OUT          P54     // Key1输出（LED1联动）
-#define KEY2_OUT          P17     // Key2输出（LED2联动）
-#define KEY3_OUT          P15     // Key3输出（Relay3电压联动）
+
+// 引脚配置表编码：模式（PxM1:PxM0）<<1 | 电平；PIN_KEEP表示不改写输出锁存器
+#define PIN_QB             0       // 准双向口（弱上拉）
+#define PIN_PP             1       // 推挽输出
+#define PIN_HZ             2       // 高阻输入
+#define PIN_OD             3       // 开漏输出
+#define PIN_KEEP           0x80
+#define PIN_CFG(mode, level) (((mode) << 1) | (level))
+#define PIN_MODE(cfg)      (((cfg) >> 1) & 0x03)
+#define PIN_PORT_P1        0
+#define PIN_PORT_P3        1
+#define PIN_PORT_P5        2
+#define PIN_PORT_COUNT     3
+#define PIN_STATE_ACTIVE   0
+#define PIN_STATE_SLEEP    1
+// 按端口编号读写（SBIT无法按下标访问；写入为单条ANL/ORL指令，可在中断中使用）
+#define PORT_READ(port)    ((port) == PIN_PORT_P1 ? P1 : ((port) == PIN_PORT_P3 ? P3 : P5))
+#define PORT_WRITE(port, mask, level)                              \
+    do                                                             \
+    {                                                              \
+        if(level)                                                  \
+        {                                                          \
+            if((port) == PIN_PORT_P1)      P1 |= (mask);           \
+            else if((port) == PIN_PORT_P3) P3 |= (mask);           \
+            else                           P5 |= (mask);           \
+        }                                                          \
+        else                                                       \
+        {                                                          \
+            if((port) == PIN_PORT_P1)      P1 &= (uint8_t)~(mask); \
+            else if((port) == PIN_PORT_P3) P3 &= (uint8_t)~(mask); \
+            else                           P5 &= (uint8_t)~(mask); \
+        }                                                          \
+    } while(0)
+// 掉电时传感器电源是否关闭：关闭时HMBC09P/2410s侧引脚须避免悬空或向其灌电流
+#ifdef DEBUG_MODE
+#define PIN_SLEEP_RAIL(rail_off, rail_on) (rail_on)
+#else
+#define PIN_SLEEP_RAIL(rail_off, rail_on) (rail_off)
+#endif
 
 /************************* 全局变量 *************************/
+// 存储区规划（8051：内部RAM仅256字节，另有1KB扩展RAM）：
+//   __bit   - 标志位，位寻址区（0x20-0x2F），SETB/CLR单周期访问
+//   __data  - 高频计数器，直接寻址区，访问最快
+//   __xdata - 大缓冲区/日志，放入1KB扩展RAM，不占用堆栈和内部RAM
+//   与中断共享的变量统一加volatile
 // 系统状态变量
-bool system_wakeup_flag = 0;      // 系统唤醒标志（P3.3中断触发）
-bool voltage_low_flag = 0;        // 低电压标记（1=低于阈值）
-bool voltage_high_flag = 0;       // 高电压标记（1=高于/等于阈值）
-uint32_t wdt_feed_timer = 0;      // 看门狗喂狗计时计数器
+volatile __bit system_wakeup_flag = 0; // 系统唤醒标志（P3.3中断置位）
+volatile __bit voltage_low_flag = 0;   // 低电压标记（1=低于阈值，LVD中断也会置位）
+__bit voltage_high_flag = 0;           // 高电压标记（1=高于/等于阈值）
+
+// 看门狗任务监督变量
+__data uint8_t wdt_task_active = 0;              // 受监督任务位图（bit n = 任务n）
+__data uint16_t wdt_task_stamp[WDT_TASK_COUNT];  // 各任务最近报到时刻（毫秒计时低16位）
+// 各任务报到截止时间（ms）
+__code const uint16_t wdt_task_deadline[WDT_TASK_COUNT] = {
+    1500,   // 输入采样：主循环每轮报到（最长阻塞为唤醒快速路径及IAP擦写）
+    1500,   // 规则判断：占用估计任务每50ms报到，同上
+    200     // Key脉冲：50ms脉冲 + 余量
+};
+
+// 协作式调度器：软定时器按到期时刻排成单链表，表头最先到期（仅主循环访问，中断不修改）
+typedef struct
+{
+    uint16_t due;               // 到期时刻（毫秒计时低16位）
+    uint16_t period;            // 周期（ms），0为一次性任务
+    uint8_t next;               // 链表中下一个任务，SCHED_NONE为表尾
+    uint8_t armed;              // 已在链表中
+} sched_timer_t;
+typedef struct
+{
+    uint16_t count;             // 运行次数
+    uint16_t max_us;            // 单次最长耗时（us）
+    uint32_t sum_us;            // 累计耗时（us）
+} sched_stat_t;
+__xdata sched_timer_t sched_timer[SCHED_TASK_COUNT];
+__xdata sched_stat_t sched_stat[SCHED_TASK_COUNT];
+__data uint8_t sched_head = SCHED_NONE;     // 最先到期的任务
+__bit power_off_due = 0;                     // 掉电前延时已到（掉电前延时任务置位）
+
+#ifdef DEBUG_MODE
+// 负载及堆栈监测
+__data uint8_t stack_base = 0;               // 涂色时的SP（其上为可用堆栈区）
+__xdata uint32_t cpu_idle_us = 0;            // 当前窗口内空闲模式累计时间
+__xdata uint32_t cpu_window_us = 0;          // 当前窗口开始时刻（us）
+__xdata uint8_t cpu_busy_pct = 0;            // 上一窗口CPU忙碌百分比
+__xdata uint8_t cpu_busy_max_pct = 0;        // 窗口忙碌百分比最大值
+__xdata uint32_t loop_us_max = 0;            // 主循环单轮最长耗时（us，不含空闲等待）
+#endif
+
+// 复位原因（上电时从WDT_CONTR/PCON标志位捕获）
+#define RESET_CAUSE_POWER_ON   0   // 上电复位（POF）
+#define RESET_CAUSE_WATCHDOG   1   // 看门狗复位（WDT_FLAG）
+#define RESET_CAUSE_BROWNOUT   2   // 低压跌落后复位（LVDF残留）
+#define RESET_CAUSE_OTHER      3   // 外部复位脚/软件复位
+#define RESET_CAUSE_COUNT      4
+
+// 运行状态面包屑（记录复位前最后所处阶段）
+#define CRUMB_BOOT             0   // 启动初始化
+#define CRUMB_SLEEP            1   // 掉电模式
+#define CRUMB_WAKE             2   // 唤醒处理（上电+延时+测压）
+#define CRUMB_LOOP             3   // 联动主循环
+#define CRUMB_PULSE            4   // Key脉冲输出
+#define CRUMB_POWER_SWITCH     5   // POWER_CTRL切换及掉电前延时
+#define CRUMB_MAINT            6   // 维护会话（仅串口1/控制台）
+
+// 中断标识（记录最后进入的中断）
+#define CRUMB_ISR_NONE         0xFF
+#define CRUMB_ISR_INT0         0
+#define CRUMB_ISR_TIMER0       1
+#define CRUMB_ISR_INT1         2
+#define CRUMB_ISR_UART1        4
+#define CRUMB_ISR_LVD          6
+#define CRUMB_ISR_PCA          7
+#define CRUMB_ISR_UART2        8
+#define CRUMB_ISR_INT4         16
+
+#define CRUMB_MAGIC            0x5AC3
+#define CRUMB_ADDR             0x03E0  // 扩展RAM末尾32字节，不参与启动清零
+
+// 面包屑区：使用__at绝对地址，启动代码不会清零，热复位后内容保留
+typedef struct
+{
+    uint16_t magic;                                // 有效标记（上电随机值时无效）
+    uint8_t  last_state;                           // 最后运行状态（CRUMB_xxx）
+    uint8_t  last_isr;                             // 最后进入的中断
+    uint32_t last_tick;                            // 最后记录状态时的毫秒计时
+    uint32_t loop_count;                           // 联动主循环计数
+    uint16_t reset_count[RESET_CAUSE_COUNT];       // 各类复位累计次数
+} crash_crumbs_t;
+
+volatile __xdata __at(CRUMB_ADDR) crash_crumbs_t crumbs;
+#ifdef DEBUG_MODE
+__xdata crash_crumbs_t crumbs_at_reset;             // 复位时面包屑快照（复位报告推迟到首次唤醒输出）
+#endif
+__bit boot_deferred_done = 0;                       // 首次唤醒已完成推迟的初始化
+__data uint16_t boot_us = 0;                        // 启动到首次掉电耗时（us，自Timer0启动计）
+__data uint8_t reset_cause = RESET_CAUSE_POWER_ON;  // 本次启动的复位原因
 
 // 定时器全局变量
-volatile uint32_t timer_ms = 0;   // 毫秒计时计数器（定时器中断累加）
+volatile __data uint32_t timer_ms = 0; // 毫秒计时计数器（定时器中断累加）
+
+// 十进制数格式化缓冲区（扩展RAM，避免占用8051堆栈；串口1和遥测共用）
+__xdata char uart_print_buf[24];
+
+// 事件日志类型
+#define JOURNAL_EV_RESET       1   // 复位（arg=复位原因，value=复位前状态）
+#define JOURNAL_EV_WAKE        2   // PIR唤醒
+#define JOURNAL_EV_PULSE       3   // Key脉冲（arg=Key编号，value=bit1脉冲前/bit0脉冲后反馈）
+#define JOURNAL_EV_VOLTAGE     4   // 电压采样（value=mV）
+#define JOURNAL_EV_SLEEP       5   // 进入掉电
+#define JOURNAL_EV_TIME        6   // 上位机对时（arg=0低16位/1高16位，value=时间偏移秒数）
+#define JOURNAL_EV_OCCUPANCY   7   // 占用状态变化（arg=新状态，value=置信度）
+#define JOURNAL_EV_ADAPT       8   // 无人确认时间调整（arg=1延长/0缩短，value=新值ms）
+#define JOURNAL_EV_SETTLE      9   // 唤醒后传感器就绪耗时（arg=1超时，value=ms）
+#define JOURNAL_EV_POWER_BAND  10  // 电源档位变化（arg=新档位，value=1为LVD中断触发）
+#define JOURNAL_EV_SOC         11  // 放电速率更新（arg=剩余天数，上限255，value=电量0.1%）
+#define JOURNAL_EV_MAINT       12  // 维护会话结束（arg=1命令Q结束/0超时/2PIR唤醒，value=会话秒数）
+
+// 日志记录（8字节，每扇区64条）
+// 写入顺序：先写数据字节，最后写seq低字节、seq高字节。
+// seq有效范围0x0000-0x7FFF，高字节为0xFF即视为未写完（撕裂写入），恢复时跳过。
+typedef struct
+{
+    uint16_t seq;      // 序号（15位循环）
+    uint8_t  type;     // 事件类型（JOURNAL_EV_xxx）
+    uint8_t  arg;      // 事件参数
+    uint16_t value;    // 事件数值
+    uint16_t time_s;   // 事件时刻（上位机时间偏移+系统时钟秒数，低16位）
+} journal_rec_t;
+
+#define JOURNAL_REC_SIZE   sizeof(journal_rec_t)
+#define JOURNAL_SIZE       ((uint16_t)JOURNAL_SECTORS * IAP_SECTOR_SIZE)
+#define JOURNAL_SEQ_MASK   0x7FFF
+
+__xdata journal_rec_t journal_ram[JOURNAL_RAM_SIZE]; // RAM暂存区
+__data uint8_t journal_ram_count = 0;                // 暂存记录数
+__data uint16_t journal_seq = 0;                     // 下一条记录序号
+__data uint16_t journal_write_addr = 0;              // 下一条记录写入偏移（相对日志区）
+__data uint8_t journal_dropped = 0;                  // 暂存区满时丢弃的记录数
+__bit journal_ready = 0;                             // 写入位置已从EEPROM恢复
+
+// 运行时参数及取值范围（上限受看门狗溢出时间约束：阻塞延时须小于2.1s）
+__xdata uint16_t param[PARAM_COUNT] = {
+    VOLTAGE_THRESHOLD, DELAY_WAKEUP, DELAY_KEY_PULSE, DELAY_POWER_OFF,
+    OCC_HOLD_MS, OCC_CONFIRM_MS
+};
+__code const uint16_t param_min[PARAM_COUNT] = { 2000,    0,  10,    0,     0,   500 };
+__code const uint16_t param_max[PARAM_COUNT] = { 5000, 1500, 150, 1200, 60000, 60000 };
+
+// 电源管理档位（电压越低档位越高）
+#define POWER_BAND_NORMAL       0       // 正常：全部功能
+#define POWER_BAND_CONSERVE     1       // 节能：仅PIR检测，不进行再入学习（定时唤醒仅用于计时）
+                                        // 雷达（2410s）与HMBC09P共用P5.5电源开关，无法单独保持雷达断电；
+                                        // 掉电唤醒定时器已接近15位计数上限（约16s），节能档不再延长定时唤醒周期
+#define POWER_BAND_CRITICAL     2       // 危急：切断传感器电源，停止串口输出，仅测压后继续掉电
+#define POWER_BAND_COUNT        3
+volatile __data uint8_t power_band = POWER_BAND_NORMAL;  // 当前档位（LVD中断可直接降档）
+volatile __bit power_band_changed = 0;       // 档位已变化，待主循环记录
+__bit power_lvd_armed = 1;                   // LVD中断已按当前档位布防（危急档及触发后未重新布防时为0）
+__xdata uint32_t power_band_time_ms[POWER_BAND_COUNT]; // 各档位累计运行时间（唤醒期间，ms）
+__data uint32_t power_band_tick = 0;         // 上次累计时刻
+
+// 人员占用估计状态
+#define OCC_ABSENT              0       // 无人（已确认）
+#define OCC_PRESENT             1       // 有人
+__data uint8_t occupancy_state = OCC_ABSENT; // 融合后的占用状态
+__data uint8_t occupancy_confidence = 0;     // 有人置信度（0~100）
+__data uint8_t occ_pir_evidence = 0;         // PIR证据（运动，触发即满值，慢衰减）
+__data uint8_t occ_radar_evidence = 0;       // 雷达证据（静止存在，慢增长，快衰减）
+__data uint16_t occ_step_tick = 0;           // 上次证据更新时刻（毫秒计时低16位）
+__data uint16_t occ_enter_tick = 0;          // 进入有人状态的时刻
+__data uint16_t occ_low_tick = 0;            // 置信度开始低于退出阈值的时刻
+__bit occ_low_pending = 0;                   // 置信度正处于低于退出阈值的确认窗口
+__bit occ_hold_done = 0;                     // 有人最短保持时间已满足
+
+// 无人确认时间自适应状态
+__data uint16_t adapt_reentry_count = 0;     // 掉电后窗口内被再次唤醒次数
+__data uint16_t adapt_rewake_avoided = 0;    // 延长部分内重新检测到人（避免的掉电-唤醒次数）
+__bit adapt_window_open = 0;                 // 掉电期间再入观察窗口开启
+__bit adapt_dirty = 0;                       // 学习值已变化，待掉电前保存
+
+// 唤醒确认统计
+__xdata uint16_t wake_genuine_count = 0;      // 确认的PIR唤醒次数
+__xdata uint16_t wake_spurious_count = 0;     // 被拒绝的误唤醒次数（未打开传感器电源）
+__bit wake_lockout = 0;                      // 误唤醒后的INT1屏蔽窗口进行中
+
+// 维护唤醒（与占用唤醒分开统计）
+volatile __bit maint_wakeup_flag = 0;        // RXD下降沿唤醒（INT4中断置位）
+__bit maint_quit = 0;                        // 控制台命令Q：立即结束维护会话
+__xdata uint16_t maint_session_count = 0;    // 维护会话次数
+__xdata uint32_t maint_time_ms = 0;          // 维护会话累计时间（ms，不计入档位运行时间）
+
+// 唤醒快速路径/后台就绪检测状态
+__xdata uint32_t wake_tick = 0;               // 本次传感器电源打开时刻（就绪检测计时起点）
+__xdata uint32_t wake_pir_tick = 0;           // 本次PIR唤醒时刻（唤醒确认开始时，开灯延迟计时起点）
+__data uint8_t settle_lines = 0;             // 就绪特征线上次采样值
+__data uint16_t settle_stable_since = 0;     // 特征线最近一次变化时刻（相对唤醒，ms）
+__bit sensor_ready = 0;                      // 2410s/HMBC09P已就绪且已完成测压
+__xdata uint16_t light_latency_last_ms = 0;   // 最近一次唤醒到开灯（Key1按下）耗时
+__xdata uint16_t light_latency_max_ms = 0;    // 唤醒到开灯最长耗时
+
+// 唤醒后传感器就绪耗时统计（ms）
+__xdata uint16_t settle_last_ms = 0;          // 最近一次
+__xdata uint16_t settle_min_ms = 0xFFFF;      // 最短
+__xdata uint16_t settle_max_ms = 0;           // 最长
+__xdata uint16_t settle_timeout_count = 0;    // 超时次数（未检测到就绪特征）
+__xdata uint32_t host_time_offset = 0;    // 上位机时间偏移（秒，T命令设置，用于日志时间戳）
+// Key脉冲状态（PCA中断与主循环共享；同一时刻只输出一个脉冲，全部通道共用PCA模块0）
+volatile __data uint8_t key_pulse_active = 0;       // 正在输出脉冲
+volatile __data uint8_t key_pulse_done = 0;         // 脉冲已结束、待记录反馈
+volatile __data uint8_t key_pulse_wraps = 0;        // 比较匹配前还需经过的PCA整圈数（65536计数）
+__data uint8_t key_pulse_chan = 0;                  // 当前脉冲通道
+__data uint8_t key_pulse_ack = 0;                   // 脉冲前反馈（bit1）
+__data uint8_t key_pulse_port = 0;                  // 当前Key端口/位/释放电平（中断释放时使用，避免查表）
+__data uint8_t key_pulse_mask = 0;
+__data uint8_t key_pulse_idle = 1;
+
+#ifdef PROFILE_MODE
+// 中断剖析（PCA自由计数，0.5us/计数；Timer0入口延迟用定时器0自身计数，1/24us/计数）
+#define PROF_SRC_INT0          0
+#define PROF_SRC_TIMER0        1
+#define PROF_SRC_INT1          2
+#define PROF_SRC_UART1         3
+#define PROF_SRC_LVD           4
+#define PROF_SRC_PCA           5
+#define PROF_SRC_UART2         6
+#define PROF_SRC_INT4          7
+#define PROF_SRC_COUNT         8
+
+typedef struct
+{
+    uint16_t min;
+    uint16_t max;
+    uint32_t sum;
+    uint16_t count;    // 饱和于0xFFFF后停止累计
+} prof_stat_t;
+
+__xdata prof_stat_t prof_lat[PROF_SRC_COUNT];   // 入口延迟（仅Timer0/PCA：事件时刻由硬件计数确定）
+__xdata prof_stat_t prof_exec[PROF_SRC_COUNT];  // 执行时间（入口到出口，含被高级中断打断的时间）
+__xdata prof_stat_t prof_t0_period;             // Timer0相邻两次入口间隔（标称2000计数=1ms）
+__data uint16_t prof_t0_last = 0;               // 上次Timer0入口时刻（PCA计数）
+__bit prof_t0_valid = 0;                        // prof_t0_last有效（掉电后首次无效）
+__code const char * __code prof_src_name[PROF_SRC_COUNT] = { "INT0", "T0", "INT1", "UART1", "LVD", "PCA", "UART2", "INT4" };
+
+// 中断内只用宏（PCA中断使用独立寄存器组，不调用函数）
+#define PROF_PCA_READ(v)                                  \
+    do                                                    \
+    {                                                     \
+        uint8_t prof_h;                                   \
+        do                                                \
+        {                                                 \
+            prof_h = CH;                                  \
+            (v) = ((uint16_t)prof_h << 8) | CL;           \
+        } while(prof_h != CH);                            \
+    } while(0)
+#define PROF_STAT(st, v)                                  \
+    do                                                    \
+    {                                                     \
+        if((st).count != 0xFFFF)                          \
+        {                                                 \
+            if((v) < (st).min) (st).min = (v);            \
+            if((v) > (st).max) (st).max = (v);            \
+            (st).sum += (v);                              \
+            (st).count++;                                 \
+        }                                                 \
+    } while(0)
+#define PROF_ENTER(t)      uint16_t t; PROF_PCA_READ(t)
+#define PROF_EXIT(src, t)                                 \
+    do                                                    \
+    {                                                     \
+        uint16_t prof_e;                                  \
+        PROF_PCA_READ(prof_e);                            \
+        prof_e -= (t);                                    \
+        PROF_STAT(prof_exec[src], prof_e);                \
+    } while(0)
+#define PCA_IDLE_STOP()                 // 剖析构建：PCA保持计数
+#else
+#define PROF_ENTER(t)
+#define PROF_EXIT(src, t)
+#define PCA_IDLE_STOP()    (CR = 0)     // 无脉冲时停止PCA计数
+#endif
+
+// 引脚配置表：工作态/掉电态（每次掉电进入和唤醒时整体写入）
+// 掉电电流（tools/replay寄存器模型回放traces/example.trace的sleep_uA列，非调试模式，电源关闭）：
+//   原配置：1122uA —— Key1~3推挽高电平经未上电HMBC09P的保护二极管倒灌（3×300uA），
+//           P1.0/P1.2/P1.6等未用脚及2410s/HMBC09P反馈线悬空高阻输入（11×20uA，输入电平落在中间时的穿通电流）
+//   本配置：2.0uA —— 未用脚推挽低、模块侧输入拉低、Key释放为高阻，仅剩MCU掉电及唤醒定时器电流
+//   每脚漏电为模型假设（--i-float-ua/--i-backfeed-ua，按STC8G数据手册典型值），绝对值以实测为准
+typedef struct
+{
+    uint8_t port;      // PIN_PORT_xx
+    uint8_t bit;       // 0~7
+    uint8_t active;    // 工作态 PIN_CFG(模式, 电平)
+    uint8_t sleep;     // 掉电态
+} pin_cfg_t;
+
+__code const pin_cfg_t pin_table[] = {
+    { PIN_PORT_P1, 0, PIN_CFG(PIN_PP, 0), PIN_CFG(PIN_PP, 0) },                                     // 未用
+    { PIN_PORT_P1, 1, PIN_CFG(PIN_QB, 1), PIN_CFG(PIN_QB, 1) },                                     // TxD2（遥测，空闲高）
+    { PIN_PORT_P1, 2, PIN_CFG(PIN_PP, 0), PIN_CFG(PIN_PP, 0) },                                     // 未用
+    { PIN_PORT_P1, 3, PIN_CFG(PIN_HZ, 1), PIN_SLEEP_RAIL(PIN_CFG(PIN_PP, 0), PIN_CFG(PIN_HZ, 1)) }, // LED3状态
+    { PIN_PORT_P1, 4, PIN_CFG(PIN_HZ, 1), PIN_SLEEP_RAIL(PIN_CFG(PIN_PP, 0), PIN_CFG(PIN_HZ, 1)) }, // Relay3反馈
+    { PIN_PORT_P1, 5, PIN_CFG(PIN_PP, 1), PIN_SLEEP_RAIL(PIN_CFG(PIN_HZ, 1), PIN_CFG(PIN_PP, 1)) }, // Key3
+    { PIN_PORT_P1, 6, PIN_CFG(PIN_PP, 0), PIN_CFG(PIN_PP, 0) },                                     // 未用
+    { PIN_PORT_P1, 7, PIN_CFG(PIN_PP, 1), PIN_SLEEP_RAIL(PIN_CFG(PIN_HZ, 1), PIN_CFG(PIN_PP, 1)) }, // Key2
+    { PIN_PORT_P3, 0, PIN_CFG(PIN_QB, 1), PIN_CFG(PIN_QB, 1) },                                     // RXD（下载口）
+    { PIN_PORT_P3, 1, PIN_CFG(PIN_QB, 1), PIN_CFG(PIN_QB, 1) },                                     // TXD（空闲高）
+    { PIN_PORT_P3, 2, PIN_CFG(PIN_HZ, 1), PIN_SLEEP_RAIL(PIN_CFG(PIN_PP, 0), PIN_CFG(PIN_HZ, 1)) }, // 2410s输出
+    { PIN_PORT_P3, 3, PIN_CFG(PIN_HZ, 1), PIN_CFG(PIN_HZ, 1) },                                     // PIR（唤醒源，独立供电）
+    { PIN_PORT_P3, 4, PIN_CFG(PIN_HZ, 1), PIN_SLEEP_RAIL(PIN_CFG(PIN_PP, 0), PIN_CFG(PIN_HZ, 1)) }, // LED1状态
+    { PIN_PORT_P3, 5, PIN_CFG(PIN_HZ, 1), PIN_SLEEP_RAIL(PIN_CFG(PIN_PP, 0), PIN_CFG(PIN_HZ, 1)) }, // LED2状态
+    { PIN_PORT_P3, 6, PIN_CFG(PIN_HZ, 1), PIN_SLEEP_RAIL(PIN_CFG(PIN_PP, 0), PIN_CFG(PIN_HZ, 1)) }, // Relay1反馈
+    { PIN_PORT_P3, 7, PIN_CFG(PIN_HZ, 1), PIN_SLEEP_RAIL(PIN_CFG(PIN_PP, 0), PIN_CFG(PIN_HZ, 1)) }, // Relay2反馈
+    { PIN_PORT_P5, 4, PIN_CFG(PIN_PP, 1), PIN_SLEEP_RAIL(PIN_CFG(PIN_HZ, 1), PIN_CFG(PIN_PP, 1)) }, // Key1
+    { PIN_PORT_P5, 5, PIN_CFG(PIN_PP, 0) | PIN_KEEP, PIN_CFG(PIN_PP, 0) | PIN_KEEP }                // 电源控制（电平由程序控制）
+};
+#define PIN_TABLE_SIZE     (sizeof(pin_table) / sizeof(pin_table[0]))
+
+// 由配置表预先计算的端口寄存器值（每端口：涉及位、M0、M1、置1位、清0位）
+typedef struct
+{
+    uint8_t mask;
+    uint8_t m0;
+    uint8_t m1;
+    uint8_t ones;
+    uint8_t zeros;
+} pin_port_cfg_t;
+__xdata pin_port_cfg_t pin_port_cfg[2][PIN_PORT_COUNT];
+
+// 联动通道描述：每通道一个Key输出和一条反馈线，主循环按表逐通道求目标状态，反馈不符则输出脉冲
+typedef struct
+{
+    uint8_t key_port;     // Key输出端口（PIN_PORT_xx）
+    uint8_t key_mask;     // Key输出位
+    uint8_t key_level;    // Key按下电平（脉冲期间电平，释放为反相）
+    uint8_t fb_port;      // 反馈线端口
+    uint8_t fb_mask;      // 反馈线位
+    uint8_t fb_on;        // 反馈线“打开”电平
+    uint8_t fb_led;       // 反馈线对应的LED线编号（闪烁解码），CHAN_LED_NONE为非LED反馈
+    uint8_t pulse_param;  // 脉冲宽度参数（param[]下标，ms）
+    uint8_t rule;         // 联动规则 CHAN_RULE_xx
+} chan_cfg_t;
+
+__code const chan_cfg_t chan_table[CHAN_COUNT] = {
+    { PIN_PORT_P5, 0x10, 0, PIN_PORT_P3, 0x10, LED_ON_LEVEL,      0,             PARAM_KEY_PULSE, CHAN_RULE_OCCUPANCY }, // Key1(P5.4) ↔ LED1(P3.4)
+    { PIN_PORT_P1, 0x80, 0, PIN_PORT_P3, 0x20, LED_ON_LEVEL,      1,             PARAM_KEY_PULSE, CHAN_RULE_OCCUPANCY }, // Key2(P1.7) ↔ LED2(P3.5)
+    { PIN_PORT_P1, 0x20, 0, PIN_PORT_P1, 0x10, RELAY3_OPEN_LEVEL, CHAN_LED_NONE, PARAM_KEY_PULSE, CHAN_RULE_VOLTAGE }    // Key3(P1.5) ↔ Relay3(P1.4)
+};
+
+// LED状态线闪烁解码：Timer0中断每1ms采样，有边沿时记录时刻及与上一边沿的间隔；主循环按间隔分类
+#define LED_LINES() \
+    ((uint8_t)LED1_STATUS | ((uint8_t)LED2_STATUS << 1) | ((uint8_t)LED3_STATUS << 2))
+volatile __data uint8_t led_lines_last = 0;               // 最近采样的LED线电平（bit n = LED线n）
+volatile __xdata uint16_t led_edge_tick[LED_LINE_COUNT];  // 最近边沿时刻（毫秒计时低16位）
+volatile __xdata uint16_t led_half_ms[LED_LINE_COUNT];    // 最近两次边沿间隔（半周期，ms）
+
+// 电压监测（LVD优先）及ADC上电统计
+__bit volt_adc_pending = 0;                  // 需要ADC测压（遥测到期/LVD状态变化/非正常档）
+__bit volt_adc_valid = 0;                    // 已有ADC测压结果（遥测计时起点有效）
+__bit adc_powered = 0;                       // ADC电源已打开
+__data uint32_t adc_on_tick = 0;             // ADC上电时刻
+__xdata uint32_t volt_adc_last_s = 0;        // 上次ADC测压时刻（系统时钟秒）
+__xdata uint32_t adc_on_ms_total = 0;        // ADC累计上电时间（ms）
+__xdata uint16_t adc_conv_count = 0;         // ADC测压次数
+__xdata uint16_t adc_skip_count = 0;         // 由LVD判定代替ADC测压的次数
+__xdata uint16_t volt_detect_us = 0;         // 最近一次ADC测压耗时（转换+除法+日志，us）
+__xdata uint16_t volt_adc_mv = 0;            // 最近一次ADC测得电压（mV）
+// RSTCFG.LVDS各档位电压（mV）：正常档按不高于电压阈值的最高档位布防（LVD触发即确实低于阈值）
+__code const uint16_t lvd_level_mv[4] = { 2000, 2400, 2700, 3000 };
+
+__data uint32_t clock_sleep_s = 0;       // 掉电期间累计秒数（定时唤醒次数×周期，不计被PIR提前唤醒的残余）
+
+// 电池电量估计（每次唤醒测压一次，非实时数据放入扩展RAM）
+// 放电曲线：VCC（mV，降序）→ 电量（0.1%），分段线性插值；2.8V危急档即视为0%
+__code const uint16_t soc_curve_mv[SOC_CURVE_POINTS] = { 3400, 3300, 3200, 3100, 3000, 2900, 2800 };
+__code const uint16_t soc_curve_pm[SOC_CURVE_POINTS] = { 1000,  900,  700,  450,  250,  100,    0 };
+__xdata uint16_t soc_vcc_x4 = 0;             // 滤波后电压×4（一阶低通，α=1/4）
+__xdata uint16_t soc_permille = 0;           // 当前电量（0.1%）
+__xdata uint16_t soc_rate_pm_day = 0;        // 放电速率（0.1%/天，滤波后）
+__xdata uint16_t soc_days_left = SOC_DAYS_UNKNOWN; // 预计剩余天数
+__xdata uint16_t soc_anchor_pm = 0;          // 速率估计起点电量
+__xdata uint32_t soc_anchor_s = 0;           // 速率估计起点时刻（系统时钟秒）
+__bit soc_anchor_valid = 0;                  // 起点已建立
+__bit soc_charge_early = 0;                  // 按放电趋势提前充电（持续到电量90%）
+
+#ifdef CONSOLE_ENABLE
+// 串口收发环形缓冲区（中断驱动，主循环不等待发送完成）
+__xdata uint8_t uart_tx_buf[UART_TX_BUF_SIZE];
+__xdata uint8_t uart_rx_buf[UART_RX_BUF_SIZE];
+volatile __data uint8_t uart_tx_head = 0;     // 发送写入位置（主循环）
+volatile __data uint8_t uart_tx_tail = 0;     // 发送读取位置（中断）
+volatile __data uint8_t uart_rx_head = 0;     // 接收写入位置（中断）
+volatile __data uint8_t uart_rx_tail = 0;     // 接收读取位置（主循环）
+volatile __bit uart_tx_busy = 0;              // 发送进行中
+__xdata char console_line[CONSOLE_LINE_SIZE]; // 命令行缓冲区
+__data uint8_t console_len = 0;               // 命令行当前长度
+#endif
+
+// 遥测发送环形缓冲区（串口2中断驱动）
+__xdata uint8_t tlm_tx_buf[TLM_TX_BUF_SIZE];
+volatile __data uint8_t tlm_tx_head = 0;      // 发送写入位置（主循环）
+volatile __data uint8_t tlm_tx_tail = 0;      // 发送读取位置（中断）
+volatile __bit tlm_tx_busy = 0;               // 发送进行中
+
+#ifdef TRACE_MODE
+// 输入轨迹记录：Timer0中断每1ms采样输入线，变化时写入记录；主循环经遥测串口输出
+// 输入线位图：bit0 PIR、bit1 雷达、bit2~4 LED1~3、bit5~7 Relay1~3反馈（原始电平）
+#define TRACE_LINES()                                                                        \
+    ((uint8_t)PIR_IN | ((uint8_t)HUMAN_2410S_IN << 1) | ((uint8_t)LED1_STATUS << 2) |       \
+     ((uint8_t)LED2_STATUS << 3) | ((uint8_t)LED3_STATUS << 4) | ((uint8_t)RELAY1_FEEDBACK << 5) | \
+     ((uint8_t)RELAY2_FEEDBACK << 6) | ((uint8_t)RELAY3_FEEDBACK << 7))
+
+typedef struct
+{
+    uint8_t type;      // TRACE_EV_xx
+    uint32_t t;        // 唤醒记录：系统时钟（s）；其余：毫秒计时
+    uint16_t val;      // 输入线位图/电压/是否确认
+} trace_rec_t;
+
+__xdata trace_rec_t trace_buf[TRACE_BUF_SIZE];
+volatile __data uint8_t trace_head = 0;       // 写入位置（Timer0中断及主循环，主循环写入时关Timer0中断）
+volatile __data uint8_t trace_tail = 0;       // 读取位置（主循环）
+__data uint8_t trace_lines_last = 0;          // 上次采样的输入线
+__data uint16_t trace_drop_count = 0;         // 缓冲区满丢弃的记录数
+__data uint32_t trace_wake_tick = 0;          // 本次确认唤醒时刻（E/V记录时间基准）
+volatile __bit trace_armed = 0;               // 确认唤醒后开始采样，掉电前停止
+
+// 中断内只用宏（避免中断内函数调用的压栈开销）
+#define TRACE_PUSH(ty, tm, v)                                        \
+    do                                                               \
+    {                                                                \
+        uint8_t trace_next = (trace_head + 1) & (TRACE_BUF_SIZE - 1); \
+        if(trace_next != trace_tail)                                 \
+        {                                                            \
+            trace_buf[trace_head].type = (ty);                       \
+            trace_buf[trace_head].t = (tm);                          \
+            trace_buf[trace_head].val = (v);                         \
+            trace_head = trace_next;                                 \
+        }                                                            \
+        else                                                         \
+        {                                                            \
+            trace_drop_count++;                                      \
+        }                                                            \
+    } while(0)
+#define TRACE_WAKE(genuine) Trace_Wake(genuine)
+#define TRACE_VOLT(mv)      Trace_Push(TRACE_EV_VOLT, Get_Tick_ms(), (mv))
+#define TRACE_TASK()        Trace_Task()
+#define TRACE_FLUSH()       Trace_Flush()
+#else
+#define TRACE_WAKE(genuine)
+#define TRACE_VOLT(mv)
+#define TRACE_TASK()
+#define TRACE_FLUSH()
+#endif
 
 /************************* 函数声明 *************************/
 // 系统初始化
-void System_Init(void);          // 系统总初始化
+void System_Init(void);          // 最小系统初始化（仅掉电所需：IO/中断/LVD）
+void Deferred_Init(void);        // 首次唤醒时完成推迟的初始化（串口/ADC/PCA/设置读取）
+void Pin_Config_Build(void);     // 由引脚配置表计算各端口寄存器值
+void Pin_Config_Apply(uint8_t state); // 整体写入工作态/掉电态引脚配置（关中断）
 void Timer0_Init(void);          // 定时器0初始化（1ms中断）
-void UART1_Init(void);           // 串口1初始化（仅调试模式编译）
-void LVD_ADC_Init(void);         // LVD+ADC初始化（CH15通道）
-void WDT_Init(void);             // 看门狗初始化（溢出时间≈1秒）
-void WDT_Feed(void);             // 看门狗喂狗
-void WDT_Stop(void);             // 关闭看门狗
+void Interrupt_Priority_Init(void); // 中断优先级配置（IP/IPH）
+void UART1_Init(void);           // 串口1初始化（调试模式/维护串口编译）
+void LVD_Init(void);             // LVD初始化（3.0V，中断方式）
+void ADC_Init(void);             // ADC初始化（CH15通道，电源关闭，测压时按需上电）
+void WDT_Init(void);             // 看门狗初始化（溢出时间≈2.1秒）
+void WDT_Feed(void);             // 看门狗喂狗（仅由监督函数调用）
+void WDT_Task_Begin(uint8_t task); // 任务开始受监督
+void WDT_Task_Checkin(uint8_t task); // 任务报到
+void WDT_Task_End(uint8_t task);   // 任务结束监督
+void WDT_Service(void);          // 监督检查：全部任务按时报到才喂狗
+void Reset_Cause_Capture(void);  // 捕获复位原因并更新复位计数（须在main最先调用）
+void Reset_Report(void);         // 串口输出复位原因及复位前面包屑（仅调试模式编译）
+void Crumb_State(uint8_t state); // 记录当前运行状态和时刻
+
+// 协作式调度器（软定时器）
+void Sched_Init(void);                           // 清空软定时器链表（每次唤醒开始时调用）
+void Sched_Start(uint8_t id, uint16_t delay_ms); // 安排一次性任务（已安排则重新计时）
+void Sched_Every(uint8_t id, uint16_t period_ms, uint16_t delay_ms); // 安排周期任务，首次在delay_ms后运行
+void Sched_Stop(uint8_t id);                     // 取消任务
+void Sched_Insert(uint8_t id, uint16_t due);     // 按到期时刻插入链表
+void Sched_Run(void);                            // 运行全部已到期任务并统计耗时
+void Sched_Idle(void);                           // 空闲钩子：无到期任务时进入空闲模式
+void Sched_Stat_Reset(void);                     // 清空任务耗时统计
+void Sched_Dump(void);                           // 串口输出任务耗时统计
+#ifdef DEBUG_MODE
+void Stack_Paint(void);                          // 堆栈涂色（启动时调用）
+uint8_t Stack_Used(void);                        // 堆栈高水位：涂色以来最大使用字节数
+void Cpu_Load_Start(void);                       // 开始CPU负载统计窗口（唤醒时调用）
+void Cpu_Load_Task(void);                        // 结束当前窗口并计算忙碌百分比（调度器周期任务）
+void Load_Report(void);                          // 串口输出CPU负载、主循环最长耗时及堆栈高水位
+#endif
+
+// 事件日志（IAP EEPROM）
+void IAP_Idle(void);                               // IAP空闲（关闭IAP，地址指向非EEPROM区）
+void IAP_Trigger(uint16_t addr, uint8_t cmd);      // IAP触发命令
+uint8_t IAP_Read_Byte(uint16_t addr);              // IAP读1字节
+void IAP_Write_Byte(uint16_t addr, uint8_t dat);   // IAP写1字节（目标须已擦除）
+void IAP_Erase_Sector(uint16_t addr);              // IAP擦除地址所在扇区
+void Journal_Log(uint8_t type, uint8_t arg, uint16_t value); // 记录事件到RAM暂存区（不访问EEPROM）
+uint16_t Journal_Read_Seq(uint16_t offset);        // 读取日志区记录序号
+bool Journal_Slot_Erased(uint16_t offset);         // 判断日志区记录位是否为空
+void Journal_Recover(void);      // 扫描EEPROM恢复序号和写入位置
+void Journal_Flush(void);        // 暂存记录批量写入EEPROM（仅在非实时路径调用）
+void Journal_Dump(void);         // 串口导出全部日志（调试模式/维护串口编译）
 
 // 工具函数
+uint32_t Get_Tick_ms(void);       // 原子读取毫秒计时（避免32位读取被中断撕裂）
+uint32_t Get_Tick_us(void);       // 微秒计时（毫秒计时 + 定时器0当前计数，用于耗时统计）
+uint32_t Clock_Get_s(void);       // 系统时钟（秒）：唤醒期间毫秒计时 + 掉电期间定时唤醒计数
 void Timer_Delay_ms(uint16_t ms); // 阻塞式毫秒延时（基于定时器）
 void UART1_SendChar(uint8_t ch);  // 串口发送单个字符
 void UART1_SendString(char *str); // 串口发送字符串
+void UART1_SendNum(uint32_t num);  // 串口发送十进制数
+char *Num_To_Str(uint32_t num);   // 十进制数格式化（返回uart_print_buf内的字符串）
+void Baud_Timer2_Init(void);      // 定时器2波特率发生器（串口1/串口2共用）
+void UART2_Init(void);            // 遥测串口初始化（仅发送，中断驱动）
+void TLM_SendChar(uint8_t ch);    // 遥测发送单个字符
+void TLM_SendString(char *str);   // 遥测发送字符串
+void TLM_Print_Field(char *name, uint32_t val); // 遥测输出"名称=值"
+void TLM_Flush(void);             // 等待遥测缓冲区发送完毕（掉电前调用）
+void Telemetry_Report(void);      // 输出本次唤醒的遥测记录（掉电前调用）
+#ifdef TRACE_MODE
+void Trace_Push(uint8_t type, uint32_t t, uint16_t val); // 主循环写入一条轨迹记录（关Timer0中断）
+void Trace_Wake(bool genuine);    // 记录唤醒；确认唤醒时开始采样输入线
+void Trace_Task(void);            // 输出一条轨迹记录（主循环调用）
+void Trace_Flush(void);           // 停止采样并输出全部轨迹记录（掉电前调用）
+#endif
+void UART1_Flush(void);           // 等待发送缓冲区发送完毕（掉电前调用）
+void Console_Task(void);          // 串口命令控制台后台任务（每轮主循环调用，不阻塞）
+void Console_Execute(void);       // 执行一条命令行
+uint32_t Console_Parse_Num(char **pp);            // 解析十进制数
+void Console_Print_Field(char *name, uint32_t val); // 输出"名称=值"
 void Print_Voltage(uint16_t volt);// 串口打印电压值（仅调试模式编译）
+void Maint_Session(void);         // 维护会话：仅串口1/控制台，无接收超时后返回
 
 // 核心功能函数
-void Enter_PowerDown_Mode(void); // 进入掉电模式
+void Enter_PowerDown_Mode(void); // 进入掉电模式（误唤醒在内部直接重新掉电）
+bool Wake_Qualify(void);         // PIR唤醒确认：P3.3电平及脉宽检查
 uint16_t Get_VCC_Voltage(void);  // 获取VCC电压（mV）
 void Detect_Voltage_Status(void);// 检测电压状态并更新标记（调试模式串口输出）
-void Output_Key1_Pulse(void);    // Key1输出0.05s低脉冲
-void Output_Key2_Pulse(void);    // Key2输出0.05s低脉冲
-void Output_Key3_Pulse(void);    // Key3输出0.05s低脉冲
-bool Check_LED1_Status(void);    // 检测LED1状态（1=亮，0=灭）
-bool Check_LED2_Status(void);    // 检测LED2状态（1=亮，0=灭）
-bool Check_Relay3_Status(void);  // 检测Relay3状态（1=打开，0=关闭）
+void Voltage_Schedule(void);     // 安排后台测压任务（ADC上电满稳定时间后执行）
+void ADC_Power_On(void);         // 打开ADC电源并记录上电时刻
+void ADC_Power_Off(void);        // 关闭ADC电源并累计上电时间
+bool Voltage_ADC_Needed(void);   // 本次唤醒是否需要ADC测压
+void Voltage_From_LVD(void);     // LVD未触发：直接判定电压高（不上电ADC）
+void PCA_Init(void);             // PCA初始化（计数器停止，脉冲开始时启动）
+uint16_t PCA_Read(void);         // 读取PCA当前计数（CH/CL防撕裂）
+bool Key_Pulse_Start(uint8_t ch); // 按下通道Key并设置比较匹配（PCA定时，不阻塞；已有脉冲进行时忽略并返回false）
+void Key_Pulse_Task(void);       // 脉冲结束后记录反馈（调度器一次性任务）
+void Key_Pulse_Abort(void);      // 立即释放全部Key并停止PCA（掉电前调用）
+bool Chan_Feedback(uint8_t ch);  // 读取通道反馈线（1=打开，0=关闭）
+uint8_t Chan_State(uint8_t ch);  // 通道解码状态（CHAN_TARGET_ON/OFF，LED闪烁或未稳定为NONE）
+void Led_Decode_Reset(void);     // LED闪烁解码复位：状态未知，须稳定LED_STEADY_MS后才判定常亮/常灭
+uint8_t Led_State(uint8_t led);  // LED线解码状态（LED_STATE_xx）
+uint8_t Chan_Target(uint8_t ch); // 按通道联动规则求目标状态
+void Linkage_Task(void);         // 逐通道执行联动规则
+#ifdef PROFILE_MODE
+void Profile_Reset(void);        // 清空中断剖析统计
+void Profile_Dump(void);         // 串口输出中断剖析统计
+void Profile_Print_Stat(char *name, __xdata prof_stat_t *st, uint16_t scale_num, uint8_t scale_den); // 输出一项剖析统计
+#endif
 void Disable_INT1(void);         // 禁用INT1中断（防重复触发）
 void Enable_INT1(void);          // 启用INT1中断（恢复唤醒）
-bool Check_Exit_Condition(void); // 检查掉电条件（P3.2+P3.3均低）
+bool Check_Exit_Condition(void); // 检查掉电条件（确认无人+P3.2+P3.3均低）
+void Sense_Task(void);           // 占用估计+联动规则（调度器周期任务）
+void Power_Off_Task(void);       // 掉电前延时到期（调度器一次性任务）
+void Occupancy_Reset(void);      // 唤醒时复位占用估计（PIR证据置满）
+void Occupancy_Update(void);     // 按时间步长更新传感器证据和占用状态
+bool Lines_Settled(uint8_t lines, uint16_t elapsed, uint16_t min_ms, uint16_t stable_ms); // 特征线稳定性跟踪
+void Wake_Light_Fast(void);      // 唤醒快速路径：HMBC09P就绪后立即开灯
+void Sensor_Ready_Start(void);   // 开始后台就绪检测
+bool Sensor_Ready_Poll(uint16_t timeout_ms); // 后台就绪检测（非阻塞），就绪或超时返回true
+void Adapt_Before_Sleep(void);   // 掉电前保存学习值并启动再入观察窗口（掉电唤醒定时器）
+void Adapt_After_Wake(void);     // 唤醒后根据再入情况调整无人确认时间
+bool Settings_Load(uint8_t tag, uint16_t *value); // 读取设置扇区中该标签的最新值
+void Settings_Save(uint8_t tag, uint16_t value);  // 追加写入设置记录（扇区满时擦除重写）
+void Power_Governor_Update(uint16_t volt); // 按测得电压选择电源档位（带回差）
+void Power_LVD_Arm(uint8_t band); // LVD按该档位的下一档电压布防（危急档关闭）
+void Power_Governor_Task(void);  // 累计各档位时间，记录档位变化（主循环调用）
+void Power_Shed_Sleep(void);     // 危急档：切断传感器电源并立即掉电
+uint16_t Soc_From_Voltage(uint16_t volt); // 放电曲线插值：电压→电量（0.1%）
+void Soc_Update(uint16_t volt);  // 更新电量、放电速率、剩余天数及提前充电请求
 
 /************************* 主函数（核心逻辑）*************************/
 void main(void)
 {
-    // 1. 系统初始化：定时器+IO+中断+ADC/LVD+看门狗（调试模式额外初始化串口）
+    // 0. 捕获复位原因（须在看门狗初始化清除WDT_FLAG之前）
+    Reset_Cause_Capture();
+#ifdef DEBUG_MODE
+    Stack_Paint();                // 调试模式：堆栈涂色（中断尚未开启）
+#endif
+    
+    // 1. 最小启动：定时器+IO+中断+LVD+看门狗，尽快进入掉电
+    //    （弱电池上反复欠压复位时，每次启动耗电越少越好；ADC/串口/PCA/设置读取推迟到首次唤醒）
     Timer0_Init();
     System_Init();
-    WDT_Init();                   // 初始化看门狗
-    WDT_Feed();                   // 首次喂狗
+    WDT_Init();                   // 初始化看门狗（内含首次喂狗）
+    Journal_Log(JOURNAL_EV_RESET, reset_cause, crumbs.last_state);
+    Crumb_State(CRUMB_BOOT);
     
     // 2. 初始进入掉电模式（低功耗）
+    boot_us = (uint16_t)Get_Tick_us();
     Enter_PowerDown_Mode();
     
     while(1)
@@ -155,141 +932,301 @@ void main(void)
         {
             system_wakeup_flag = 0; // 清除唤醒标志
             Disable_INT1();         // 屏蔽INT1中断，防止重复触发
-            WDT_Init();             // 唤醒后重新初始化看门狗
-            WDT_Feed();             // 唤醒后立即喂狗
-            wdt_feed_timer = 0;     // 重置喂狗计时器
+            WDT_Init();             // 唤醒后重新初始化看门狗及任务监督
+            Sched_Init();           // 软定时器从本次唤醒重新开始
+            Sched_Every(SCHED_TASK_WDT, WDT_FEED_INTERVAL, WDT_FEED_INTERVAL);
+            power_band_tick = Get_Tick_ms(); // 档位时间从本次占用唤醒起算（不计入维护会话）
+            if(!boot_deferred_done)
+            {
+                Deferred_Init();    // 首次唤醒：串口/ADC/PCA/设置读取
+            }
+            Journal_Log(JOURNAL_EV_WAKE, 0, 0);
             
-            // 唤醒后：打开电源（调试模式下始终保持打开，无需重复设置）
-#ifndef DEBUG_MODE
+            // 危急档：不打开传感器电源，先测压，电压仍未恢复则继续掉电
+            if(power_band == POWER_BAND_CRITICAL)
+            {
+                ADC_Power_On();
+                Timer_Delay_ms(ADC_SETTLE_MS);
+                Detect_Voltage_Status();
+                if(power_band == POWER_BAND_CRITICAL)
+                {
+                    Power_Shed_Sleep();
+                    continue;
+                }
+            }
+            
+            // 唤醒后：打开电源（调试模式下常开，仅危急档切断后需要在此恢复）
+            wake_tick = Get_Tick_ms();
+            Crumb_State(CRUMB_POWER_SWITCH);
             POWER_CTRL = POWER_ON_LEVEL;
-#endif
+            Crumb_State(CRUMB_WAKE);
+            
+            // 快速路径：仅等待HMBC09P的LED线稳定，立即开灯（Key1）
+            // 掉电期间定时器0停止、LED线无记录：解码从未知状态起算，启动跳变及配对闪烁期间联动保持现状
+            Led_Decode_Reset();
+            Wake_Light_Fast();
             
-            // 延时0.5秒（定时器精准实现）
-            Timer_Delay_ms(DELAY_WAKEUP);
+            // 后台路径：仅在需要测压时ADC上电，2410s就绪检测和测压在联动循环中完成
+            volt_adc_pending = Voltage_ADC_Needed();
+            if(volt_adc_pending)
+            {
+                ADC_Power_On();
+            }
+            Sensor_Ready_Start();
             
-            // 检测电压并标记高低（调试模式串口输出电压值）
-            Detect_Voltage_Status();
+            // 占用估计从PIR唤醒证据开始；占用估计+联动规则任务立即运行一次，此后每个证据步长运行
+            Occupancy_Reset();
+            power_off_due = 0;
+            Sched_Every(SCHED_TASK_SENSE, OCC_STEP_MS, 0);
+#ifdef DEBUG_MODE
+            Cpu_Load_Start();
+            Sched_Every(SCHED_TASK_LOAD, CPU_LOAD_WINDOW_MS, CPU_LOAD_WINDOW_MS);
+#endif
             
-            // 核心循环：持续执行联动逻辑，直到满足掉电条件
+            // 核心循环：轮询输入并运行到期任务，直到满足掉电条件
             while(1)
             {
-                // 看门狗喂狗逻辑：每500ms喂一次狗
-                if(timer_ms - wdt_feed_timer >= WDT_FEED_INTERVAL)
-                {
-                    WDT_Feed();
-                    wdt_feed_timer = timer_ms;
-                }
+#ifdef DEBUG_MODE
+                uint32_t loop_start_us = Get_Tick_us();
+#endif
+                Crumb_State(CRUMB_LOOP);
+                crumbs.loop_count++;
                 
-                // 循环逻辑：LED1关闭 → Key1输出0.05s低脉冲
-                if(Check_LED1_Status() == 0)
-                {
-                    Output_Key1_Pulse();
-                }
+                // 输入采样任务报到（本轮循环开始读取输入）
+                WDT_Task_Checkin(WDT_TASK_INPUT);
                 
-                /************************* 执行逻辑①：有人+LED2关闭 → Key2脉冲 *************************/
-                if(HUMAN_2410S_IN == 1 && Check_LED2_Status() == 0)
+                // 后台：2410s/HMBC09P就绪后安排测压（ADC稳定后由测压任务执行，不阻塞联动逻辑），无需ADC时由LVD判定
+                if(!sensor_ready && Sensor_Ready_Poll(param[PARAM_DELAY_WAKEUP]))
                 {
-                    Output_Key2_Pulse();
+                    if(volt_adc_pending)
+                    {
+                        Voltage_Schedule();
+                    }
+                    else
+                    {
+                        Voltage_From_LVD();
+                    }
                 }
                 
-                /************************* 执行逻辑③：电压联动Relay3 → Key3脉冲 *************************/
-                // 电压低 + Relay3关闭 → Key3脉冲
-                if(voltage_low_flag && Check_Relay3_Status() == 0)
+                // 电源档位：危急档立即切断电源并掉电
+                Power_Governor_Task();
+                if(power_band == POWER_BAND_CRITICAL)
                 {
-                    Output_Key3_Pulse();
+                    Power_Shed_Sleep();
+                    break;
                 }
-                // 电压高 + Relay3打开 → Key3脉冲
-                else if(voltage_high_flag && Check_Relay3_Status() == 1)
+                
+                // 到期任务：看门狗监督、脉冲结束记录、测压、占用估计+联动规则（有人/无人、电压高/低）、掉电前延时
+                Sched_Run();
+                
+                // 检查掉电条件：确认无人 + P3.2（无人）+ P3.3（无PIR）均低 + 无脉冲进行
+                // 条件成立时开始掉电前延时（期间继续运行任务），延时内条件不再成立则取消
+                if(!Check_Exit_Condition())
                 {
-                    Output_Key3_Pulse();
+                    power_off_due = 0;
+                    Sched_Stop(SCHED_TASK_POWER_OFF);
                 }
-                
-                /************************* 执行逻辑④：无人+LED2打开 → Key2脉冲+额外判断 *************************/
-                if(HUMAN_2410S_IN == 0 && Check_LED2_Status() == 1)
+                else if(!power_off_due)
                 {
-                    // 无人+LED2打开 → Key2输出0.05s低脉冲
-                    Output_Key2_Pulse();
-                    
-                    // LED1打开 → Key1输出0.05s低脉冲
-                    if(Check_LED1_Status() == 1)
+                    if(!sched_timer[SCHED_TASK_POWER_OFF].armed)
                     {
-                        Output_Key1_Pulse();
+                        Crumb_State(CRUMB_POWER_SWITCH);
+                        Sched_Start(SCHED_TASK_POWER_OFF, param[PARAM_POWER_OFF]);
                     }
+                }
+                else
+                {
+                    // 掉电条件持续满足掉电前延时：严格按文档顺序执行
+                    // 1. 掉电前延时（1秒）已由调度器完成
+                    power_off_due = 0;
+                    Crumb_State(CRUMB_POWER_SWITCH);
                     
-                    // 检查掉电条件：P3.2（无人）+ P3.3（无PIR）均低
-                    if(Check_Exit_Condition())
-                    {
-                        // 满足掉电条件：严格按文档顺序执行
-                        // 1. 延时1秒
-                        Timer_Delay_ms(DELAY_POWER_OFF);
-                        
-                        // 2. 关闭电源（仅非调试模式执行）
+                    // 2. 关闭电源（仅非调试模式执行）
 #ifndef DEBUG_MODE
-                        POWER_CTRL = POWER_OFF_LEVEL;
-#endif
-                        
-                        // 3. 恢复INT1中断，允许下次唤醒
-                        Enable_INT1();
-                        
-                        // 4. 关闭看门狗 → 进入掉电模式（掉电模式下看门狗自动休眠）
-                        WDT_Stop();
-                        Enter_PowerDown_Mode();
-                    }
+                    POWER_CTRL = POWER_OFF_LEVEL;
+#endif
+                    
+                    // 3. 遥测记录；日志及学习参数写入EEPROM（掉电前非实时阶段），开启再入观察窗口
+                    Telemetry_Report();
+#ifdef DEBUG_MODE
+                    Load_Report();
+#endif
+                    Journal_Log(JOURNAL_EV_SLEEP, 0, param[PARAM_OCC_CONFIRM]);
+                    Journal_Flush();
+                    Adapt_Before_Sleep();
+                    
+                    // 4. 恢复INT1中断，允许下次唤醒
+                    Enable_INT1();
+                    
+                    // 5. 喂狗后进入掉电模式（WDT_CONTR无法软件关闭，掉电模式下停止计数）
+                    WDT_Feed();
+                    Crumb_State(CRUMB_SLEEP);
+                    Enter_PowerDown_Mode();
+                    Adapt_After_Wake();     // 根据是否在观察窗口内被PIR唤醒调整无人确认时间
+                    
+                    // 6. 唤醒后跳出联动循环，重新执行唤醒流程（上电+延时+测压）
+                    break;
+                }
+                
+                // 日志暂存区将满时写入EEPROM（须无脉冲进行：IAP期间CPU暂停，会推迟PCA释放沿）
+                if(journal_ram_count >= JOURNAL_FLUSH_LEVEL && !key_pulse_active)
+                {
+                    Journal_Flush();
                 }
                 
-                // 不满足掉电条件 → 继续循环
+                // 轨迹记录构建：每轮输出一条记录
+                TRACE_TASK();
+#ifdef CONSOLE_ENABLE
+                // 串口命令控制台（处理已接收的字节，不等待）
+                Console_Task();
+#endif
+                
+                // 不满足掉电条件 → 空闲至下一个中断（最迟1ms节拍）后继续循环
+#ifdef DEBUG_MODE
+                loop_start_us = Get_Tick_us() - loop_start_us;
+                if(loop_start_us > loop_us_max)
+                {
+                    loop_us_max = loop_start_us;
+                }
+#endif
+                Sched_Idle();
+            }
+        }
+#ifdef CONSOLE_ENABLE
+        else if(maint_wakeup_flag)
+        {
+            // RXD唤醒：只服务串口命令（不打开传感器电源），无接收超时后继续掉电；
+            // 会话期间确认的PIR唤醒转入正常唤醒流程
+            maint_wakeup_flag = 0;
+            Maint_Session();
+            if(system_wakeup_flag)
+            {
+                continue;
             }
+            WDT_Feed();
+            Crumb_State(CRUMB_SLEEP);
+            Enter_PowerDown_Mode();
+        }
+#endif
+        else
+        {
+            // 掉电唤醒定时器到期唤醒（计时/再入观察窗口结束）：累计掉电时间，直接继续掉电
+            clock_sleep_s += CLOCK_TICK_S;
+            WDT_Feed();
+            Crumb_State(CRUMB_SLEEP);
+            Enter_PowerDown_Mode();
         }
     }
 }
 
 /************************* 函数实现 *************************/
-// 系统初始化：IO/中断/ADC/LVD + 调试模式串口初始化
+// 最小系统初始化：IO/中断/LVD（掉电及唤醒所需），其余外设见Deferred_Init
 void System_Init(void)
 {
-    // 1. IO口模式配置
-    // P3口：P3.2-P3.7 高阻输入；P3.0(RX1)/P3.1(TX1) 串口复用（调试模式）
-    P3M0 &= ~0xFC;
-    P3M1 |= 0xFC;
-    
-    // P1口：P12.-P1.4 高阻输入；P1.5/P1.7 推挽输出（PxM0=1, PxM1=0）
-    P1M0 = (P1M0 & ~0x5c) | 0xa0; 
-    P1M1 = (P1M1 & ~0xa0) | 0x5c; 
-
-    
-    // P5口：P5.4/P5.5 推挽输出（PxM0=1, PxM1=0）
-    P5M0 |= 0x30;
-    P5M1 &= ~0x30;
+    // 1. IO口模式及输出口初始化（见引脚配置表pin_table：Key输出高、输入高阻、未用脚推挽低）
+    Pin_Config_Build();
+    Pin_Config_Apply(PIN_STATE_ACTIVE);
     
-    // 2. 输出口初始化
-    KEY1_OUT = 1;
-    KEY2_OUT = 1;
-    KEY3_OUT = 1;
-    
-    // 3. 电源初始化（预定义形式控制）
+    // 2. 电源初始化（预定义形式控制）
 #ifdef DEBUG_MODE
     POWER_CTRL = POWER_ON_LEVEL;  // 调试模式：P5.5初始化为低（电源常开）
-    UART1_Init();                 // 调试模式：初始化串口1（115200波特率）
 #else
     POWER_CTRL = POWER_OFF_LEVEL; // 非调试模式：P5.5初始化为高（电源关闭）
 #endif
     
-    // 4. 中断配置
+    // 3. 中断配置
+    Interrupt_Priority_Init();
     IT0 = 1;  // INT0（P3.2）下降沿触发（预留）
-    IT1 = 1;  // INT1（P3.3）上升沿触发（核心唤醒源）
+    IT1 = 0;  // INT1（P3.3）上升沿和下降沿均触发（STC8G：IT1=1仅下降沿），下降沿唤醒由Wake_Qualify拒绝
     EX0 = 1;  // 开启INT0（预留）
     EX1 = 1;  // 开启INT1
     EA = 1;   // 开启总中断
     
-    // 5. ADC+LVD初始化
-    LVD_ADC_Init();
+    // 4. LVD初始化
+    LVD_Init();
+}
+
+// PIR唤醒确认：唤醒后P3.3须已为高电平并持续WAKE_QUAL_MS（亚毫秒毛刺和短暂热扰动脉冲被拒绝）
+bool Wake_Qualify(void)
+{
+    uint32_t start_ms = Get_Tick_ms();
+
+    wake_pir_tick = start_ms;   // 掉电期间定时器0停止：唤醒后第一次读取即中断唤醒时刻
+
+    while((Get_Tick_ms() - start_ms) < WAKE_QUAL_MS)
+    {
+        if(!PIR_IN)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 由引脚配置表计算两种状态下各端口的模式位和电平位
+void Pin_Config_Build(void)
+{
+    uint8_t i, s, cfg, bitmask;
+    __xdata pin_port_cfg_t *pc;
+
+    for(i = 0; i < PIN_TABLE_SIZE; i++)
+    {
+        bitmask = (uint8_t)(1 << pin_table[i].bit);
+        for(s = 0; s < 2; s++)
+        {
+            cfg = (s == PIN_STATE_ACTIVE) ? pin_table[i].active : pin_table[i].sleep;
+            pc = &pin_port_cfg[s][pin_table[i].port];
+            pc->mask |= bitmask;
+            if(PIN_MODE(cfg) & 0x01) pc->m0 |= bitmask;
+            if(PIN_MODE(cfg) & 0x02) pc->m1 |= bitmask;
+            if(!(cfg & PIN_KEEP))
+            {
+                if(cfg & 0x01) pc->ones |= bitmask;
+                else           pc->zeros |= bitmask;
+            }
+        }
+    }
+}
+
+// 整体写入引脚配置：先写电平再写模式（切换为推挽前锁存器已是目标电平，无毛刺）
+void Pin_Config_Apply(uint8_t state)
+{
+    __xdata pin_port_cfg_t *pc = pin_port_cfg[state];
+    bool ea_saved = EA;
+
+    EA = 0;
+    P1 = (P1 | pc[PIN_PORT_P1].ones) & ~pc[PIN_PORT_P1].zeros;
+    P1M0 = (P1M0 & ~pc[PIN_PORT_P1].mask) | pc[PIN_PORT_P1].m0;
+    P1M1 = (P1M1 & ~pc[PIN_PORT_P1].mask) | pc[PIN_PORT_P1].m1;
+    P3 = (P3 | pc[PIN_PORT_P3].ones) & ~pc[PIN_PORT_P3].zeros;
+    P3M0 = (P3M0 & ~pc[PIN_PORT_P3].mask) | pc[PIN_PORT_P3].m0;
+    P3M1 = (P3M1 & ~pc[PIN_PORT_P3].mask) | pc[PIN_PORT_P3].m1;
+    P5 = (P5 | pc[PIN_PORT_P5].ones) & ~pc[PIN_PORT_P5].zeros;
+    P5M0 = (P5M0 & ~pc[PIN_PORT_P5].mask) | pc[PIN_PORT_P5].m0;
+    P5M1 = (P5M1 & ~pc[PIN_PORT_P5].mask) | pc[PIN_PORT_P5].m1;
+    EA = ea_saved;
+}
+
+// 首次唤醒时执行：串口（调试模式/维护串口，调试模式随后输出复位报告）、ADC、PCA、恢复学习值
+void Deferred_Init(void)
+{
+#ifdef CONSOLE_ENABLE
+    UART1_Init();                 // 初始化串口1（115200波特率）
+#endif
+#ifdef DEBUG_MODE
+    Reset_Report();               // 输出复位原因及复位前面包屑
+#endif
+    UART2_Init();                 // 遥测串口（调试/非调试模式均可用）
+    ADC_Init();
+    PCA_Init();                   // Key脉冲硬件定时
+    Settings_Load(SETTING_ABSENCE_TIMEOUT, &param[PARAM_OCC_CONFIRM]); // 恢复学习得到的无人确认时间
+    boot_deferred_done = 1;
 }
 
 // 定时器0初始化：1T模式，1ms中断一次（24MHz晶振）
 void Timer0_Init(void)
 {
-    TMOD &= 0xF0;               // 清除定时器0模式位
-    TMOD |= 0x01;               // 定时器0模式1（16位）
+    TMOD &= 0xF0;               // 定时器0模式0（STC8G：16位自动重载，中断延迟不累积到节拍）
     AUXR |= 0x80;               // 定时器0使用1T模式（STC8G特有）
     
     // 设置定时器重载值（1ms中断）
@@ -302,280 +1239,2468 @@ void Timer0_Init(void)
     EA = 1;                     // 开启总中断
 }
 
-// 串口1初始化（仅调试模式编译）：115200波特率，8N1，24MHz晶振
-#ifdef DEBUG_MODE
-void UART1_Init(void)
+// 中断优先级：脉冲释放沿 > 1ms节拍 > 唤醒/LVD > 串口/INT0
+// 高级中断可打断低级中断，最坏延迟见中断服务函数区说明
+void Interrupt_Priority_Init(void)
 {
-    SCON = 0x50;                // 8位数据，可变波特率
-    AUXR |= 0x01;               // 串口1使用定时器2作为波特率发生器
-    AUXR |= 0x04;               // 定时器2为1T模式
-    T2L = 0xCC;                 // 波特率重载值低8位
-    T2H = 0xFF;                 // 波特率重载值高8位
-    AUXR |= 0x10;               // 启动定时器2
-    ES = 1;                     // 开启串口1中断（可选，此处仅发送无需中断）
+    PPCA = 1;                   // PCA：3级
+    IPH |= PPCAH;
+    PT0 = 0;                    // Timer0：2级
+    IPH |= PT0H;
+    PX1 = 1;                    // INT1：1级
+    IPH &= ~PX1H;
+    PLVD = 1;                   // LVD：1级
+    IPH &= ~PLVDH;
+    PS = 0;                     // UART1：0级
+    IPH &= ~PSH;
+    PX0 = 0;                    // INT0：0级
+    IPH &= ~PX0H;
+    IP2 &= ~PS2;                // UART2：0级
+    IP2H &= ~PS2H;
 }
 
-// 串口1发送单个字符
-void UART1_SendChar(uint8_t ch)
+/************************* 串口命令控制台（调试模式/维护串口编译） *************************/
+// 命令（一行一条，回车/换行结束，大小写敏感）：
+//   S          查询输入口及状态
+//   G          读取全部运行时参数（序号=值）
+//   P i v      设置参数i为v（超出范围拒绝）
+//   K n        手动输出Key n脉冲（n=1~3）
+//   C          输出复位/日志计数器
+//   T s        设置上位机时间偏移（秒），并写入对时日志
+//   J          导出事件日志
+//   R [1]      输出中断剖析统计（剖析构建），带1则输出后清空
+//   A [1]      输出调度器任务统计（运行次数/平均/最长耗时us），带1则输出后清空（调试模式同时清空负载峰值）
+//   Q          结束维护会话并掉电（维护唤醒时）
+#ifdef CONSOLE_ENABLE
+// 解析十进制数，*pp指向下一个非数字字符
+uint32_t Console_Parse_Num(char **pp)
 {
-    SBUF = ch;
-    while(!TI);                 // 等待发送完成
-    TI = 0;                     // 清除发送标志
-}
+    uint32_t val = 0;
+    char *p = *pp;
 
-// 串口1发送字符串
-void UART1_SendString(char *str)
-{
-    while(*str != '\0')
+    while(*p == ' ')
     {
-        UART1_SendChar(*str++);
+        p++;
+    }
+    while(*p >= '0' && *p <= '9')
+    {
+        val = val * 10 + (uint8_t)(*p - '0');
+        p++;
     }
+    *pp = p;
+    return val;
 }
 
-// 串口打印电压值（格式：VCC Voltage: XXXX mV\r\n）
-void Print_Voltage(uint16_t volt)
+// 输出"名称=值"
+void Console_Print_Field(char *name, uint32_t val)
 {
-    char buf[32];
-    // 格式化电压字符串
-    sprintf(buf, "VCC Voltage: %d mV\r\n", volt);
-    // 发送字符串
-    UART1_SendString(buf);
+    UART1_SendString(name);
+    UART1_SendChar('=');
+    UART1_SendNum(val);
+    UART1_SendChar(' ');
 }
-#endif
 
-// LVD+ADC初始化（CH15通道：内部参考电压）
-void LVD_ADC_Init(void)
+// 执行一条命令行
+void Console_Execute(void)
 {
-    P1ASF = 0x00;               // P1口不作为ADC输入
-    ADC_CONTR = 0x80;           // 开启ADC电源（ADON=1）
-    ADC_RES = 0;                // 清空ADC结果寄存器
-    ADC_RESL = 0;
-    Timer_Delay_ms(2);          // ADC电源稳定延时（定时器实现）
-    ADC_CONTR |= 0x0F;          // 选择CH15通道
-    IE2 |= 0x80;                // 开启LVD中断允许位
-    
-    // LVD配置（3V阈值）
-    LVDCR = 0x00;               // 清空配置
-    LVDCR |= (0b100 << 1);      // LVD阈值3.0V
-    LVDCR |= 0x01;              // 开启LVD检测
-    PCON &= ~LVDF;              // 清除LVD中断标志
-}
+    char *p = &console_line[1];
+    char name[4];
+    uint8_t i;
+    uint32_t val;
 
-// 看门狗初始化：溢出时间≈1秒（STC8G1K17，24MHz晶振）
-void WDT_Init(void)
-{
-    WDTCN = 0x00;               // 解锁看门狗寄存器
-    WDTCN = 0x80;               // 启用看门狗（溢出时间≈1秒）
+    switch(console_line[0])
+    {
+    case 'S':
+        Console_Print_Field("P32", HUMAN_2410S_IN);
+        Console_Print_Field("P33", PIR_IN);
+        name[0] = 'F';
+        name[1] = 'B';
+        name[3] = '\0';
+        for(i = 0; i < CHAN_COUNT; i++)
+        {
+            name[2] = (char)('1' + i);       // 通道反馈：FB1、FB2…
+            Console_Print_Field(name, Chan_Feedback(i));
+        }
+        name[0] = 'L';
+        name[1] = 'D';
+        for(i = 0; i < LED_LINE_COUNT; i++)
+        {
+            name[2] = (char)('1' + i);       // LED解码状态：LD1、LD2…（0灭 1亮 2慢闪 3快闪）
+            Console_Print_Field(name, Led_State(i));
+        }
+        Console_Print_Field("OCC", occupancy_state);
+        Console_Print_Field("CONF", occupancy_confidence);
+        Console_Print_Field("VLOW", voltage_low_flag);
+        Console_Print_Field("PWR", POWER_CTRL == POWER_ON_LEVEL);
+        Console_Print_Field("STATE", crumbs.last_state);
+        Console_Print_Field("TICK", Get_Tick_ms());
+        break;
+    case 'G':
+        for(i = 0; i < PARAM_COUNT; i++)
+        {
+            UART1_SendNum(i);
+            UART1_SendChar('=');
+            UART1_SendNum(param[i]);
+            UART1_SendChar(' ');
+        }
+        break;
+    case 'P':
+        i = (uint8_t)Console_Parse_Num(&p);
+        val = Console_Parse_Num(&p);
+        if(i >= PARAM_COUNT || val < param_min[i] || val > param_max[i])
+        {
+            UART1_SendString("ERR");
+            break;
+        }
+        param[i] = (uint16_t)val;
+        UART1_SendString("OK");
+        break;
+    case 'K':
+        i = (uint8_t)Console_Parse_Num(&p);
+        if(i < 1 || i > CHAN_COUNT)
+        {
+            UART1_SendString("ERR");
+            break;
+        }
+        if(!Key_Pulse_Start(i - 1))
+        {
+            UART1_SendString("BUSY"); // 已有脉冲进行中，本次未执行
+            break;
+        }
+        UART1_SendString("OK");
+        break;
+    case 'C':
+        for(i = 0; i < RESET_CAUSE_COUNT; i++)
+        {
+            Console_Print_Field("RST", crumbs.reset_count[i]);
+        }
+        Console_Print_Field("LOOPS", crumbs.loop_count);
+        Console_Print_Field("JSEQ", journal_seq);
+        Console_Print_Field("JPEND", journal_ram_count);
+        Console_Print_Field("JDROP", journal_dropped);
+        Console_Print_Field("LIGHT", light_latency_last_ms);
+        Console_Print_Field("LMAX", light_latency_max_ms);
+        Console_Print_Field("SETTLE", settle_last_ms);
+        Console_Print_Field("SMIN", settle_min_ms);
+        Console_Print_Field("SMAX", settle_max_ms);
+        Console_Print_Field("STMO", settle_timeout_count);
+        Console_Print_Field("BAND", power_band);
+        for(i = 0; i < POWER_BAND_COUNT; i++)
+        {
+            Console_Print_Field("TBAND", power_band_time_ms[i]);
+        }
+        Console_Print_Field("REENTRY", adapt_reentry_count);
+        Console_Print_Field("AVOIDED", adapt_rewake_avoided);
+        Console_Print_Field("WAKEOK", wake_genuine_count);
+        Console_Print_Field("WAKESPUR", wake_spurious_count);
+        Console_Print_Field("SOC", soc_permille);
+        Console_Print_Field("RATE", soc_rate_pm_day);
+        Console_Print_Field("DAYS", soc_days_left);
+        Console_Print_Field("CHG", soc_charge_early);
+        Console_Print_Field("CLOCK", Clock_Get_s());
+        Console_Print_Field("ADCN", adc_conv_count);
+        Console_Print_Field("ADCSKIP", adc_skip_count);
+        Console_Print_Field("ADCMS", adc_on_ms_total);
+        Console_Print_Field("VDUS", volt_detect_us);
+        Console_Print_Field("BOOTUS", boot_us);
+        Console_Print_Field("MAINT", maint_session_count);
+        Console_Print_Field("MAINTMS", maint_time_ms);
+#ifdef DEBUG_MODE
+        Console_Print_Field("CPU", cpu_busy_pct);
+        Console_Print_Field("CPUMAX", cpu_busy_max_pct);
+        Console_Print_Field("LOOPUS", loop_us_max);
+        Console_Print_Field("STACK", Stack_Used());
+        Console_Print_Field("STACKFREE", 0xFF - stack_base - Stack_Used());
+#endif
+        // 节省估计：跳过次数×单次测压耗时（唤醒路径，us）、跳过次数×平均每次测压ADC上电时间（ms）
+        Console_Print_Field("WSAVE", (uint32_t)adc_skip_count * volt_detect_us);
+        Console_Print_Field("ASAVE", adc_conv_count ? (uint32_t)adc_skip_count * (adc_on_ms_total / adc_conv_count) : 0);
+        break;
+    case 'T':
+        host_time_offset = Console_Parse_Num(&p) - Clock_Get_s();
+        Journal_Log(JOURNAL_EV_TIME, 0, (uint16_t)host_time_offset);
+        Journal_Log(JOURNAL_EV_TIME, 1, (uint16_t)(host_time_offset >> 16));
+        UART1_SendString("OK");
+        break;
+    case 'J':
+        Journal_Dump();
+        return;
+    case 'Q':
+        maint_quit = 1;
+        UART1_SendString("OK");
+        break;
+    case 'A':
+        Sched_Dump();
+        if(Console_Parse_Num(&p) == 1)
+        {
+            Sched_Stat_Reset();
+        }
+        return;
+#ifdef PROFILE_MODE
+    case 'R':
+        Profile_Dump();
+        if(Console_Parse_Num(&p) == 1)
+        {
+            Profile_Reset();
+        }
+        return;
+#endif
+    default:
+        UART1_SendString("ERR");
+        break;
+    }
+    UART1_SendString("\r\n");
 }
 
-// 看门狗喂狗：重置看门狗计数器
-void WDT_Feed(void)
+// 控制台后台任务：取出已接收的全部字节拼成命令行，遇回车/换行执行
+// 只处理缓冲区中已有的数据，从不等待接收
+void Console_Task(void)
 {
-    WDTCN = 0x00;               // 解锁看门狗寄存器
-    WDTCN = 0xAA;               // 喂狗指令
+    uint8_t ch;
+
+    while(uart_rx_tail != uart_rx_head)
+    {
+        ch = uart_rx_buf[uart_rx_tail];
+        uart_rx_tail = (uart_rx_tail + 1) & (UART_RX_BUF_SIZE - 1);
+
+        if(ch == '\r' || ch == '\n')
+        {
+            if(console_len != 0)
+            {
+                console_line[console_len] = '\0';
+                Console_Execute();
+                console_len = 0;
+            }
+        }
+        else if(console_len < CONSOLE_LINE_SIZE - 1)
+        {
+            console_line[console_len++] = (char)ch;
+        }
+    }
 }
+#endif
 
-// 关闭看门狗
-void WDT_Stop(void)
+// 串口1初始化（调试模式/维护串口编译）：115200波特率，8N1，24MHz晶振
+#ifdef CONSOLE_ENABLE
+void UART1_Init(void)
 {
-    WDTCN = 0x00;               // 解锁看门狗寄存器
-    WDTCN = 0xDE;               // 关闭看门狗
+    SCON = 0x50;                // 8位数据，可变波特率
+    AUXR |= 0x01;               // 串口1使用定时器2作为波特率发生器
+    Baud_Timer2_Init();
+    ES = 1;                     // 开启串口1中断（收发均由中断驱动）
 }
 
-// 阻塞式毫秒延时函数（基于定时器0，精准无阻塞）
-void Timer_Delay_ms(uint16_t ms)
+// 串口1发送单个字符：写入发送缓冲区，由中断逐字节发出；仅在缓冲区满时等待
+// 危急档停止串口输出以节省电能
+void UART1_SendChar(uint8_t ch)
 {
-    uint32_t start_ms = timer_ms; // 记录延时开始时间
-    // 等待计时达到指定毫秒数（差值判断避免溢出）
-    while((timer_ms - start_ms) < ms);
-}
+    uint8_t next = (uart_tx_head + 1) & (UART_TX_BUF_SIZE - 1);
 
-// 进入掉电模式（仅P3.3上升沿中断可唤醒）
+    if(power_band == POWER_BAND_CRITICAL)
+    {
+        return;
+    }
+
+    while(next == uart_tx_tail);  // 缓冲区满：等待中断取走一个字节
+    uart_tx_buf[uart_tx_head] = ch;
+    ES = 0;
+    uart_tx_head = next;
+    if(!uart_tx_busy)
+    {
+        uart_tx_busy = 1;
+        TI = 1;                 // 软件置位TI，进入中断启动发送
+    }
+    ES = 1;
+}
+
+// 等待发送缓冲区发送完毕（最长约64字节×87us）
+void UART1_Flush(void)
+{
+    while(uart_tx_busy);
+}
+
+// 串口1发送字符串
+void UART1_SendString(char *str)
+{
+    while(*str != '\0')
+    {
+        UART1_SendChar(*str++);
+    }
+}
+
+// 串口发送十进制数
+void UART1_SendNum(uint32_t num)
+{
+    UART1_SendString(Num_To_Str(num));
+}
+
+#ifdef DEBUG_MODE
+// 串口打印电压值（格式：VCC Voltage: XXXX mV\r\n）
+void Print_Voltage(uint16_t volt)
+{
+    UART1_SendString("VCC Voltage: ");
+    UART1_SendNum(volt);
+    UART1_SendString(" mV\r\n");
+}
+
+// 串口输出复位原因、各类复位计数及复位前的面包屑
+void Reset_Report(void)
+{
+    uint8_t i;
+
+    UART1_SendString("\r\nReset cause: ");
+    UART1_SendNum(reset_cause);
+    UART1_SendString(" (0=POR 1=WDT 2=BOR 3=EXT/SW)\r\nReset counts:");
+    for(i = 0; i < RESET_CAUSE_COUNT; i++)
+    {
+        UART1_SendChar(' ');
+        UART1_SendNum(crumbs_at_reset.reset_count[i]);
+    }
+    UART1_SendString("\r\nLast state: ");
+    UART1_SendNum(crumbs_at_reset.last_state);
+    UART1_SendString(" ISR: ");
+    UART1_SendNum(crumbs_at_reset.last_isr);
+    UART1_SendString(" tick: ");
+    UART1_SendNum(crumbs_at_reset.last_tick);
+    UART1_SendString(" ms loops: ");
+    UART1_SendNum(crumbs_at_reset.loop_count);
+    UART1_SendString("\r\nBoot to first sleep: ");
+    UART1_SendNum(boot_us);
+    UART1_SendString(" us\r\n");
+}
+
+// 负载报告（格式：CPU busy: 上一窗口% (max 最大%) loop max: XX us stack: 已用/可用）
+void Load_Report(void)
+{
+    UART1_SendString("CPU busy: ");
+    UART1_SendNum(cpu_busy_pct);
+    UART1_SendString("% (max ");
+    UART1_SendNum(cpu_busy_max_pct);
+    UART1_SendString("%) loop max: ");
+    UART1_SendNum(loop_us_max);
+    UART1_SendString(" us stack: ");
+    UART1_SendNum(Stack_Used());
+    UART1_SendChar('/');
+    UART1_SendNum(0xFF - stack_base);
+    UART1_SendString("\r\n");
+}
+#endif
+
+// 维护会话：RXD唤醒后只开串口1和控制台，传感器电源保持关闭、引脚维持掉电态
+// 每收到数据重新计时，连续MAINT_IDLE_MS无接收或收到命令Q后返回（由调用者重新掉电）；
+// INT1在会话期间保持开启，PIR唤醒立即结束会话，确认后保留system_wakeup_flag由主循环执行正常唤醒流程
+void Maint_Session(void)
+{
+    uint32_t start_ms, last_rx_ms;
+
+    Crumb_State(CRUMB_MAINT);
+    WDT_Init();
+    Sched_Init();
+    Sched_Every(SCHED_TASK_WDT, WDT_FEED_INTERVAL, WDT_FEED_INTERVAL);
+    if(!boot_deferred_done)
+    {
+        Deferred_Init();
+    }
+    maint_session_count++;
+    maint_quit = 0;
+    console_len = 0;
+    start_ms = Get_Tick_ms();
+    last_rx_ms = start_ms;
+    UART1_SendString("MAINT\r\n");
+
+    while(!maint_quit && !system_wakeup_flag && Get_Tick_ms() - last_rx_ms < MAINT_IDLE_MS)
+    {
+        // 控制台循环同时承担输入和规则两项看门狗报到
+        WDT_Task_Checkin(WDT_TASK_INPUT);
+        WDT_Task_Checkin(WDT_TASK_RULES);
+        Sched_Run();
+        if(uart_rx_tail != uart_rx_head)
+        {
+            last_rx_ms = Get_Tick_ms();
+            Console_Task();
+        }
+        Sched_Idle();           // 串口接收中断或1ms节拍唤醒
+    }
+
+    start_ms = Get_Tick_ms() - start_ms;
+    maint_time_ms += start_ms;
+    Journal_Log(JOURNAL_EV_MAINT, system_wakeup_flag ? 2 : maint_quit, (uint16_t)(start_ms / 1000));
+    UART1_SendString("BYE\r\n");
+
+    // PIR唤醒：与掉电中相同做脉宽确认；未通过则清除标志（不留给下次掉电唤醒误判），由调用者重新掉电
+    if(system_wakeup_flag)
+    {
+        if(Wake_Qualify())
+        {
+            wake_genuine_count++;
+            TRACE_WAKE(1);
+            Pin_Config_Apply(PIN_STATE_ACTIVE);     // 正常唤醒流程按工作态引脚打开传感器电源
+        }
+        else
+        {
+            system_wakeup_flag = 0;
+            wake_spurious_count++;
+            TRACE_WAKE(0);
+        }
+    }
+}
+#endif
+
+// 十进制数格式化：从缓冲区尾部倒序填入数字，返回首字符位置
+// 不使用sprintf：其格式化过程需要大量堆栈和约2KB代码空间
+char *Num_To_Str(uint32_t num)
+{
+    uint8_t i = sizeof(uart_print_buf) - 1;
+
+    uart_print_buf[i] = '\0';
+    do
+    {
+        uart_print_buf[--i] = (char)('0' + num % 10);
+        num /= 10;
+    } while(num != 0 && i > 0);
+
+    return &uart_print_buf[i];
+}
+
+// 定时器2：1T模式，115200波特率（24MHz），串口1（调试）与串口2（遥测）共用
+void Baud_Timer2_Init(void)
+{
+    AUXR |= T2x12;              // 定时器2为1T模式
+    T2L = (uint8_t)(65536 - FOSC / 4 / BAUDRATE);        // 波特率重载值低8位
+    T2H = (uint8_t)((65536 - FOSC / 4 / BAUDRATE) >> 8); // 波特率重载值高8位
+    AUXR |= T2R;                // 启动定时器2
+}
+
+// 遥测串口初始化：串口2默认引脚（P_SW2.S2_S=0，TxD2=P1.1），8位可变波特率，不接收
+void UART2_Init(void)
+{
+    P_SW2 &= ~0x01;
+    S2CON = 0x00;               // 模式0（8位可变波特率），S2REN=0
+    Baud_Timer2_Init();
+    IE2 |= ES2;                 // 开启串口2中断（发送由中断驱动）
+}
+
+// 遥测发送单个字符：写入缓冲区，由中断逐字节发出；仅在缓冲区满时等待
+// 危急档停止遥测输出以节省电能
+void TLM_SendChar(uint8_t ch)
+{
+    uint8_t next = (tlm_tx_head + 1) & (TLM_TX_BUF_SIZE - 1);
+
+    if(power_band == POWER_BAND_CRITICAL)
+    {
+        return;
+    }
+
+    while(next == tlm_tx_tail);   // 缓冲区满：等待中断取走一个字节
+    tlm_tx_buf[tlm_tx_head] = ch;
+    IE2 &= ~ES2;
+    tlm_tx_head = next;
+    if(!tlm_tx_busy)
+    {
+        tlm_tx_busy = 1;
+        S2CON |= S2TI;          // 软件置位S2TI，进入中断启动发送
+    }
+    IE2 |= ES2;
+}
+
+// 遥测发送字符串
+void TLM_SendString(char *str)
+{
+    while(*str != '\0')
+    {
+        TLM_SendChar(*str++);
+    }
+}
+
+// 遥测输出"名称=值 "
+void TLM_Print_Field(char *name, uint32_t val)
+{
+    TLM_SendString(name);
+    TLM_SendChar('=');
+    TLM_SendString(Num_To_Str(val));
+    TLM_SendChar(' ');
+}
+
+// 等待遥测缓冲区发送完毕（最长约64字节×87us）
+void TLM_Flush(void)
+{
+    while(tlm_tx_busy);
+}
+
+// 遥测记录（每次唤醒结束、掉电前一行）：
+// TLM T=系统时钟s VCC=mV SOC=0.1% BAND=档位 DAYS=剩余天数 WAKE=确认唤醒 SPUR=误唤醒 LAT=唤醒到开灯ms FB=通道反馈位图
+void Telemetry_Report(void)
+{
+    uint8_t ch, fb = 0;
+
+    for(ch = 0; ch < CHAN_COUNT; ch++)
+    {
+        if(Chan_Feedback(ch))
+        {
+            fb |= (uint8_t)(1 << ch);
+        }
+    }
+    TLM_SendString("TLM ");
+    TLM_Print_Field("T", Clock_Get_s());
+    TLM_Print_Field("VCC", soc_vcc_x4 >> 2);
+    TLM_Print_Field("SOC", soc_permille);
+    TLM_Print_Field("BAND", power_band);
+    TLM_Print_Field("DAYS", soc_days_left);
+    TLM_Print_Field("WAKE", wake_genuine_count);
+    TLM_Print_Field("SPUR", wake_spurious_count);
+    TLM_Print_Field("LAT", light_latency_last_ms);
+    TLM_Print_Field("FB", fb);
+    TLM_Print_Field("MNT", maint_time_ms / 1000);
+    TLM_SendString("\r\n");
+}
+
+#ifdef TRACE_MODE
+// 主循环写入轨迹记录：与Timer0中断共用写入位置，写入期间关Timer0中断
+void Trace_Push(uint8_t type, uint32_t t, uint16_t val)
+{
+    bool et0_saved = ET0;
+
+    ET0 = 0;
+    TRACE_PUSH(type, t, val);
+    ET0 = et0_saved;
+}
+
+// 唤醒记录：误唤醒只记录时刻；确认唤醒记录时刻和当前输入线快照，并开始每1ms采样
+void Trace_Wake(bool genuine)
+{
+    Trace_Push(TRACE_EV_WAKE, Clock_Get_s(), genuine);
+    if(genuine)
+    {
+        trace_wake_tick = Get_Tick_ms();
+        trace_lines_last = TRACE_LINES();
+        Trace_Push(TRACE_EV_EDGE, trace_wake_tick, trace_lines_last);
+        trace_armed = 1;
+    }
+}
+
+// 输出一条轨迹记录（E/V时间换算为唤醒后毫秒数）
+void Trace_Task(void)
+{
+    __xdata trace_rec_t *rec;
+    uint32_t t;
+
+    if(trace_tail == trace_head)
+    {
+        return;
+    }
+    rec = &trace_buf[trace_tail];
+    t = (rec->type == TRACE_EV_WAKE) ? rec->t : rec->t - trace_wake_tick;
+    TLM_SendChar(rec->type);
+    TLM_SendChar(' ');
+    TLM_SendString(Num_To_Str(t));
+    TLM_SendChar(' ');
+    TLM_SendString(Num_To_Str(rec->val));
+    TLM_SendString("\r\n");
+    trace_tail = (trace_tail + 1) & (TRACE_BUF_SIZE - 1);
+}
+
+// 掉电前：停止采样，输出全部记录及丢弃条数
+void Trace_Flush(void)
+{
+    trace_armed = 0;
+    while(trace_tail != trace_head)
+    {
+        Trace_Task();
+    }
+    if(trace_drop_count != 0)
+    {
+        TLM_SendChar(TRACE_EV_DROP);
+        TLM_SendChar(' ');
+        TLM_SendString(Num_To_Str(trace_drop_count));
+        TLM_SendString("\r\n");
+        trace_drop_count = 0;
+    }
+}
+#endif
+
+// ADC初始化（CH15通道：内部参考电压）：电源保持关闭，测压前上电并等待ADC_SETTLE_MS
+void ADC_Init(void)
+{
+    P1ASF = 0x00;               // P1口不作为ADC输入
+    ADC_RES = 0;                // 清空ADC结果寄存器
+    ADC_RESL = 0;
+    ADC_CONTR = 0x0F;           // 选择CH15通道，ADC电源关闭
+}
+
+// LVD初始化（3V阈值，中断方式，不复位）
+void LVD_Init(void)
+{
+    RSTCFG = (RSTCFG & ~0x43) | LVD_LEVEL_3V0; // ENLVR=0，LVDS=3.0V
+    PCON &= ~LVDF;              // 清除LVD中断标志
+    ELVD = 1;                   // 开启LVD中断允许位
+}
+
+// 看门狗初始化：溢出时间≈2.1秒（STC8G1K17，24MHz晶振），空闲模式下继续计数（按墙钟时间），掉电模式停止
+// 重置任务监督：输入采样和规则判断常驻监督，Key脉冲按需监督
+void WDT_Init(void)
+{
+    uint8_t i;
+    uint16_t now = (uint16_t)Get_Tick_ms();
+
+    for(i = 0; i < WDT_TASK_COUNT; i++)
+    {
+        wdt_task_stamp[i] = now;
+    }
+    wdt_task_active = (1 << WDT_TASK_INPUT) | (1 << WDT_TASK_RULES);
+
+    WDT_Feed();                 // 启用看门狗并清零计数
+}
+
+// 看门狗喂狗：单条寄存器写入，无任何I/O
+// IDL_WDT：主循环/维护会话大部分时间处于空闲模式，不置位时空闲期间停止计数，任务停止报到要很久才复位
+void WDT_Feed(void)
+{
+    WDT_CONTR = EN_WDT | CLR_WDT | IDL_WDT | WDT_PS;
+}
+
+// 任务开始受监督（Key脉冲等短时任务）
+void WDT_Task_Begin(uint8_t task)
+{
+    wdt_task_stamp[task] = (uint16_t)Get_Tick_ms();
+    wdt_task_active |= (uint8_t)(1 << task);
+}
+
+// 任务报到：记录最近一次取得进展的时刻
+void WDT_Task_Checkin(uint8_t task)
+{
+    wdt_task_stamp[task] = (uint16_t)Get_Tick_ms();
+}
+
+// 任务结束监督
+void WDT_Task_End(uint8_t task)
+{
+    wdt_task_active &= (uint8_t)~(1 << task);
+}
+
+// 看门狗监督：任一受监督任务超过截止时间未报到则停止喂狗，由硬件复位
+void WDT_Service(void)
+{
+    uint8_t i;
+    uint8_t mask = 0x01;
+    uint16_t now = (uint16_t)Get_Tick_ms();
+
+    for(i = 0; i < WDT_TASK_COUNT; i++, mask <<= 1)
+    {
+        if((wdt_task_active & mask) &&
+           (uint16_t)(now - wdt_task_stamp[i]) > wdt_task_deadline[i])
+        {
+            return;
+        }
+    }
+    WDT_Feed();
+}
+
+// 原子读取毫秒计时：8051按字节读取32位变量，读取期间需屏蔽定时器0中断
+uint32_t Get_Tick_ms(void)
+{
+    uint32_t now;
+    bool et0_saved = ET0;
+
+    ET0 = 0;
+    now = timer_ms;
+    ET0 = et0_saved;
+    return now;
+}
+
+// 微秒计时：定时器0为1T模式，自重载值起每24个计数为1us
+// 溢出标志已置位但中断尚未执行时，计数已自动重载重新开始，补加1ms
+uint32_t Get_Tick_us(void)
+{
+    uint32_t ms;
+    uint16_t cnt;
+    uint8_t th;
+    bool et0_saved = ET0;
+
+    ET0 = 0;
+    do
+    {
+        th = TH0;
+        cnt = ((uint16_t)th << 8) | TL0;
+    } while(th != TH0);
+    ms = timer_ms;
+    if(TF0)
+    {
+        ms++;
+        cnt = ((uint16_t)TH0 << 8) | TL0;
+    }
+    cnt -= (uint16_t)TIMER0_RELOAD;
+    ET0 = et0_saved;
+    return ms * 1000 + cnt / (FOSC / 1000000);
+}
+
+// 系统时钟（秒）：Timer0在掉电期间停止，掉电时间由定时唤醒次数补足
+// 被PIR提前唤醒时不足一个周期的部分不计入（平均每次少计约7.5s）
+uint32_t Clock_Get_s(void)
+{
+    return clock_sleep_s + Get_Tick_ms() / 1000;
+}
+
+// 捕获复位原因：WDT_FLAG > POF > LVDF > 其他，并累加对应复位计数
+// 面包屑区魔数无效（完全掉电后RAM为随机值）时清零整个区域
+void Reset_Cause_Capture(void)
+{
+    uint8_t i;
+
+    if(WDT_CONTR & WDT_FLAG)
+    {
+        reset_cause = RESET_CAUSE_WATCHDOG;
+        WDT_CONTR &= ~WDT_FLAG;
+    }
+    else if(PCON & POF)
+    {
+        reset_cause = RESET_CAUSE_POWER_ON;
+    }
+    else if(PCON & LVDF)
+    {
+        reset_cause = RESET_CAUSE_BROWNOUT;
+    }
+    else
+    {
+        reset_cause = RESET_CAUSE_OTHER;
+    }
+    PCON &= ~(POF | LVDF);
+
+    if(crumbs.magic != CRUMB_MAGIC)
+    {
+        crumbs.magic = CRUMB_MAGIC;
+        crumbs.last_state = CRUMB_BOOT;
+        crumbs.last_isr = CRUMB_ISR_NONE;
+        crumbs.last_tick = 0;
+        crumbs.loop_count = 0;
+        for(i = 0; i < RESET_CAUSE_COUNT; i++)
+        {
+            crumbs.reset_count[i] = 0;
+        }
+    }
+    crumbs.reset_count[reset_cause]++;
+#ifdef DEBUG_MODE
+    crumbs_at_reset = crumbs;
+#endif
+}
+
+// 记录当前运行状态及时刻（写入面包屑区）
+void Crumb_State(uint8_t state)
+{
+    crumbs.last_state = state;
+    crumbs.last_tick = Get_Tick_ms();
+}
+
+// 阻塞式毫秒延时函数（基于定时器0，精准无阻塞）
+void Timer_Delay_ms(uint16_t ms)
+{
+    uint32_t start_ms = Get_Tick_ms(); // 记录延时开始时间
+    // 等待计时达到指定毫秒数（差值判断避免溢出）
+    while((Get_Tick_ms() - start_ms) < ms);
+}
+
+/************************* 协作式调度器（软定时器） *************************/
+// 任务函数表（下标为SCHED_TASK_*）及统计输出名称
+void (* __code const sched_fn[SCHED_TASK_COUNT])(void) = {
+    WDT_Service, Sense_Task, Key_Pulse_Task, Detect_Voltage_Status, Power_Off_Task,
+#ifdef DEBUG_MODE
+    Cpu_Load_Task,
+#endif
+};
+__code const char * __code sched_name[SCHED_TASK_COUNT] = {
+    "WDT", "SENSE", "PULSE", "VOLT", "PWROFF",
+#ifdef DEBUG_MODE
+    "LOAD",
+#endif
+};
+
+// 清空软定时器链表（统计保留，串口命令A清空）
+void Sched_Init(void)
+{
+    uint8_t i;
+
+    for(i = 0; i < SCHED_TASK_COUNT; i++)
+    {
+        sched_timer[i].armed = 0;
+    }
+    sched_head = SCHED_NONE;
+}
+
+// 按到期时刻插入链表：同一时刻到期的任务按插入先后运行（差值比较，计时回绕不影响顺序）
+void Sched_Insert(uint8_t id, uint16_t due)
+{
+    uint8_t prev = SCHED_NONE;
+    uint8_t cur = sched_head;
+
+    while(cur != SCHED_NONE && (int16_t)(due - sched_timer[cur].due) >= 0)
+    {
+        prev = cur;
+        cur = sched_timer[cur].next;
+    }
+    sched_timer[id].due = due;
+    sched_timer[id].next = cur;
+    sched_timer[id].armed = 1;
+    if(prev == SCHED_NONE)
+    {
+        sched_head = id;
+    }
+    else
+    {
+        sched_timer[prev].next = id;
+    }
+}
+
+// 取消任务：从链表中摘除（未安排时无操作）
+void Sched_Stop(uint8_t id)
+{
+    uint8_t prev = SCHED_NONE;
+    uint8_t cur = sched_head;
+
+    if(!sched_timer[id].armed)
+    {
+        return;
+    }
+    while(cur != id)
+    {
+        prev = cur;
+        cur = sched_timer[cur].next;
+    }
+    if(prev == SCHED_NONE)
+    {
+        sched_head = sched_timer[id].next;
+    }
+    else
+    {
+        sched_timer[prev].next = sched_timer[id].next;
+    }
+    sched_timer[id].armed = 0;
+}
+
+// 安排一次性任务：delay_ms后运行（0为下一次Sched_Run），已安排则按新延时重新计时
+void Sched_Start(uint8_t id, uint16_t delay_ms)
+{
+    Sched_Stop(id);
+    sched_timer[id].period = 0;
+    Sched_Insert(id, (uint16_t)Get_Tick_ms() + delay_ms);
+}
+
+// 安排周期任务：delay_ms后首次运行，此后每period_ms运行一次
+void Sched_Every(uint8_t id, uint16_t period_ms, uint16_t delay_ms)
+{
+    Sched_Stop(id);
+    sched_timer[id].period = period_ms;
+    Sched_Insert(id, (uint16_t)Get_Tick_ms() + delay_ms);
+}
+
+// 运行全部已到期任务（运行至结束，不抢占）：
+// 周期任务先按固定节拍重新插入（运行中可取消自身），落后超过一个周期则从当前时刻起算，不补运行
+void Sched_Run(void)
+{
+    uint8_t id;
+    uint16_t now, due, run_us;
+    uint32_t start_us;
+
+    while(sched_head != SCHED_NONE)
+    {
+        now = (uint16_t)Get_Tick_ms();
+        id = sched_head;
+        if((int16_t)(now - sched_timer[id].due) < 0)
+        {
+            break;
+        }
+        sched_head = sched_timer[id].next;
+        sched_timer[id].armed = 0;
+        if(sched_timer[id].period != 0)
+        {
+            due = sched_timer[id].due + sched_timer[id].period;
+            if((int16_t)(now - due) >= 0)
+            {
+                due = now + sched_timer[id].period;
+            }
+            Sched_Insert(id, due);
+        }
+
+        start_us = Get_Tick_us();
+        sched_fn[id]();
+        run_us = (uint16_t)(Get_Tick_us() - start_us);
+        sched_stat[id].count++;
+        sched_stat[id].sum_us += run_us;
+        if(run_us > sched_stat[id].max_us)
+        {
+            sched_stat[id].max_us = run_us;
+        }
+    }
+}
+
+// 空闲钩子：本节拍内无到期任务时进入空闲模式（CPU停止，外设继续运行），
+// 任一中断唤醒（Timer0节拍最迟1ms，另有PCA脉冲结束、串口收发、LVD），唤醒后继续主循环轮询输入
+void Sched_Idle(void)
+{
+#ifdef DEBUG_MODE
+    uint32_t start_us;
+#endif
+
+    if(sched_head != SCHED_NONE && (int16_t)((uint16_t)Get_Tick_ms() - sched_timer[sched_head].due) >= 0)
+    {
+        return;
+    }
+#ifdef DEBUG_MODE
+    start_us = Get_Tick_us();
+#endif
+    PCON |= IDL;
+    NOP();
+    NOP();
+#ifdef DEBUG_MODE
+    cpu_idle_us += Get_Tick_us() - start_us;   // 含唤醒中断的服务时间（Timer0约2us/ms）
+#endif
+}
+
+void Sched_Stat_Reset(void)
+{
+    uint8_t i;
+
+    for(i = 0; i < SCHED_TASK_COUNT; i++)
+    {
+        sched_stat[i].count = 0;
+        sched_stat[i].max_us = 0;
+        sched_stat[i].sum_us = 0;
+    }
+#ifdef DEBUG_MODE
+    cpu_busy_max_pct = 0;
+    loop_us_max = 0;
+#endif
+}
+
+#ifdef DEBUG_MODE
+/************************* 负载及堆栈监测（仅调试模式） *************************/
+// 堆栈涂色：SP之上至内部RAM顶端填入STACK_PAINT（main最先调用，此时中断未开、堆栈最浅）
+// 地址用8位变量递增，避免idata指针越过0xFF回绕
+void Stack_Paint(void)
+{
+    uint8_t addr = SP;
+
+    stack_base = addr;
+    while(addr != 0xFF)
+    {
+        addr++;
+        *(__idata uint8_t *)addr = STACK_PAINT;
+    }
+}
+
+// 堆栈高水位：自顶端向下找到第一个被改写的字节，返回其距涂色时SP的字节数
+// （局部变量恰好写入涂色值时少算，误差可忽略）
+uint8_t Stack_Used(void)
+{
+    uint8_t addr = 0xFF;
+
+    while(addr > stack_base && *(__idata uint8_t *)addr == STACK_PAINT)
+    {
+        addr--;
+    }
+    return addr - stack_base;
+}
+
+// 开始负载统计窗口：清空空闲累计时间（掉电期间不计入负载）
+void Cpu_Load_Start(void)
+{
+    cpu_idle_us = 0;
+    cpu_window_us = Get_Tick_us();
+}
+
+// 负载窗口结束：忙碌百分比 = (窗口时长 - 空闲模式时间) / 窗口时长
+void Cpu_Load_Task(void)
+{
+    uint32_t now_us = Get_Tick_us();
+    uint32_t span_us = now_us - cpu_window_us;
+
+    cpu_busy_pct = (span_us > cpu_idle_us) ? (uint8_t)((span_us - cpu_idle_us) * 100 / span_us) : 0;
+    if(cpu_busy_pct > cpu_busy_max_pct)
+    {
+        cpu_busy_max_pct = cpu_busy_pct;
+    }
+    cpu_idle_us = 0;
+    cpu_window_us = now_us;
+}
+#endif
+
+#ifdef CONSOLE_ENABLE
+// 每个任务一行：名称 n=运行次数 us=平均/最长耗时
+void Sched_Dump(void)
+{
+    uint8_t i;
+
+    UART1_SendString("SCHED us mean/max\r\n");
+    for(i = 0; i < SCHED_TASK_COUNT; i++)
+    {
+        UART1_SendString((char *)sched_name[i]);
+        UART1_SendString(" n=");
+        UART1_SendNum(sched_stat[i].count);
+        UART1_SendString(" us=");
+        if(sched_stat[i].count == 0)
+        {
+            UART1_SendString("-\r\n");
+            continue;
+        }
+        UART1_SendNum(sched_stat[i].sum_us / sched_stat[i].count);
+        UART1_SendChar('/');
+        UART1_SendNum(sched_stat[i].max_us);
+        UART1_SendString("\r\n");
+    }
+}
+#endif
+
+// 进入掉电模式（P3.3上升沿中断或掉电唤醒定时器唤醒）
+// 仅在确认的PIR唤醒或计时唤醒时返回；误唤醒在此直接重新掉电（不动POWER_CTRL，不开传感器电源）
 void Enter_PowerDown_Mode(void)
 {
-    // 关闭定时器0，降低功耗
-    TR0 = 0;
-    ET0 = 0;
-    
-    // 关闭所有中断（仅保留INT1中断用于唤醒）
-    EA = 0;
-    EX0 = 0;
-    IE2 &= ~0x80; // 关闭LVD中断
+    uint16_t count;
+
+    // 关闭定时器0，降低功耗
+    TR0 = 0;
+    ET0 = 0;
+    
+#ifdef CONSOLE_ENABLE
+    UART1_Flush(); // 发送完缓冲区内容（须在关闭中断前）
+    ES = 0;       // 关闭串口1中断（掉电期间由INT4检测RXD）
+    AUXINTIF &= ~INT4IF;
+    INTCLKO |= EX4;
+#endif
+    TRACE_FLUSH();        // 轨迹记录构建：输出本次唤醒的全部记录
+    TLM_Flush();          // 遥测发送完毕后关闭串口2中断并停止波特率定时器
+    IE2 &= ~ES2;
+    AUXR &= ~T2R;
+    ADC_Power_Off();    // 关闭ADC电源（通常测压后已关闭）
+    Key_Pulse_Abort();  // PCA时钟在掉电期间停止，未结束的脉冲立即释放
+    Pin_Config_Apply(PIN_STATE_SLEEP); // 引脚切换为掉电态（避免悬空及向未上电模块灌电流）
+    
+    // 关闭其他中断源（仅保留INT1中断用于唤醒，总中断保持开启以便唤醒后立即响应）
+    EX0 = 0;
+    ELVD = 0;     // 关闭LVD中断
+    EA = 1;
+    
+    while(1)
+    {
+        // 屏蔽窗口内关闭INT1，唤醒定时器按屏蔽时间计数；否则按时钟/再入观察窗口周期计数
+        if(wake_lockout)
+        {
+            EX1 = 0;
+            count = (uint16_t)((uint32_t)WAKE_LOCKOUT_MS * 1000 / WKT_TICK_US);
+        }
+        else
+        {
+            EX1 = 1;  // 保留INT1中断
+            count = (uint16_t)((uint32_t)ADAPT_REENTRY_WINDOW_MS * 1000 / WKT_TICK_US);
+        }
+        
+        // 掉电唤醒定时器：每次进入掉电重新计数
+        WKTCL = (uint8_t)count;
+        WKTCH = (uint8_t)(count >> 8) | WKTEN;
+        
+        // 置位PD位进入掉电模式，等待INT1中断或定时器唤醒
+        PCON |= 0x02;
+        NOP();
+        NOP();
+        
+        // 定时器0用于脉宽确认（引脚仍为掉电态：P3.3在两种状态下均为高阻输入）
+        ET0 = 1;
+        TR0 = 1;
+        
+        if(wake_lockout && !maint_wakeup_flag)
+        {
+            // 屏蔽窗口结束：计入时钟，丢弃窗口内锁存的边沿；PIR此时仍为高电平则按唤醒确认，
+            // 否则按正常周期继续掉电（不返回主循环，避免再按定时唤醒计入一次时钟）
+            wake_lockout = 0;
+            clock_sleep_s += WAKE_LOCKOUT_MS / 1000;
+            IE1 = 0;
+            EX1 = 1;
+            if(!PIR_IN)
+            {
+                TR0 = 0;
+                ET0 = 0;
+                continue;
+            }
+            system_wakeup_flag = 1;
+        }
+        
+        if(!system_wakeup_flag || Wake_Qualify())
+        {
+            break;
+        }
+        
+        // 误唤醒：计数后开启屏蔽窗口，直接重新掉电
+        system_wakeup_flag = 0;
+        wake_spurious_count++;
+        TRACE_WAKE(0);
+        wake_lockout = 1;
+        TR0 = 0;
+        ET0 = 0;
+    }
+    // PIR唤醒：先恢复引脚工作态（须在打开传感器电源之前），再恢复中断；
+    // 维护/定时唤醒传感器电源保持关闭，引脚维持掉电态（Key推挽高不向未上电的HMBC09P灌电流）
+    if(system_wakeup_flag)
+    {
+        wake_genuine_count++;
+        TRACE_WAKE(1);
+        Pin_Config_Apply(PIN_STATE_ACTIVE);
+    }
+    EA = 1;
+    EX0 = 1;
+#ifdef PROFILE_MODE
+    prof_t0_valid = 0;  // 掉电期间定时器停止，下一次节拍间隔不计入抖动统计
+#endif
+    PCON &= ~LVDF;
+    ELVD = power_lvd_armed;
+    if(boot_deferred_done)
+    {
+        AUXR |= T2R;  // 恢复波特率定时器及遥测串口中断（首次唤醒由Deferred_Init初始化）
+        IE2 |= ES2;
+    }
+#ifdef CONSOLE_ENABLE
+    INTCLKO &= ~EX4; // 运行期间RXD为串口数据，不再产生INT4
+    ES = 1;          // 恢复串口1中断
+#endif
+}
+
+/************************* 事件日志（IAP EEPROM） *************************/
+// IAP空闲：关闭IAP功能并将地址指向非EEPROM区，防止误操作
+void IAP_Idle(void)
+{
+    IAP_CONTR = 0;
+    IAP_CMD = IAP_IDL;
+    IAP_TRIG = 0;
+    IAP_ADDRH = 0x80;
+    IAP_ADDRL = 0;
+}
+
+// IAP触发：设置地址和命令后写入触发序列，CPU暂停至操作完成
+void IAP_Trigger(uint16_t addr, uint8_t cmd)
+{
+    IAP_CONTR = IAPEN;
+    IAP_TPS = (uint8_t)(FOSC / 1000000);
+    IAP_CMD = cmd;
+    IAP_ADDRL = (uint8_t)addr;
+    IAP_ADDRH = (uint8_t)(addr >> 8);
+    IAP_TRIG = 0x5A;
+    IAP_TRIG = 0xA5;
+    NOP();
+}
+
+// IAP读1字节
+uint8_t IAP_Read_Byte(uint16_t addr)
+{
+    uint8_t dat;
+
+    IAP_Trigger(addr, IAP_READ);
+    dat = IAP_DATA;
+    IAP_Idle();
+    return dat;
+}
+
+// IAP写1字节（目标字节须已擦除为0xFF）
+void IAP_Write_Byte(uint16_t addr, uint8_t dat)
+{
+    IAP_DATA = dat;
+    IAP_Trigger(addr, IAP_WRITE);
+    IAP_Idle();
+}
+
+// IAP擦除地址所在扇区（约4~6ms）
+void IAP_Erase_Sector(uint16_t addr)
+{
+    IAP_Trigger(addr, IAP_ERASE);
+    IAP_Idle();
+}
+
+// 读取日志区偏移处记录的序号
+uint16_t Journal_Read_Seq(uint16_t offset)
+{
+    uint16_t addr = JOURNAL_BASE_ADDR + offset;
+
+    return ((uint16_t)IAP_Read_Byte(addr + 1) << 8) | IAP_Read_Byte(addr);
+}
+
+// 判断日志区偏移处记录是否全为0xFF（未写入）
+bool Journal_Slot_Erased(uint16_t offset)
+{
+    uint8_t i;
+
+    for(i = 0; i < JOURNAL_REC_SIZE; i++)
+    {
+        if(IAP_Read_Byte(JOURNAL_BASE_ADDR + offset + i) != 0xFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 记录事件到RAM暂存区：仅写扩展RAM，可在任意实时路径调用
+void Journal_Log(uint8_t type, uint8_t arg, uint16_t value)
+{
+    __xdata journal_rec_t *rec;
+
+    if(journal_ram_count >= JOURNAL_RAM_SIZE)
+    {
+        if(journal_dropped != 0xFF)
+        {
+            journal_dropped++;
+        }
+        return;
+    }
+    rec = &journal_ram[journal_ram_count++];
+    rec->type = type;
+    rec->arg = arg;
+    rec->value = value;
+    rec->time_s = (uint16_t)(host_time_offset + Clock_Get_s());
+}
+
+// 扫描EEPROM：找到序号最新的记录，其后第一个空位即为写入位置
+// 撕裂写入的记录（seq高字节为0xFF但非全空）被跳过，不会被当作有效记录
+void Journal_Recover(void)
+{
+    uint16_t offset, seq;
+    uint16_t last_offset = JOURNAL_SIZE;
+    uint16_t last_seq = 0;
+
+    for(offset = 0; offset < JOURNAL_SIZE; offset += JOURNAL_REC_SIZE)
+    {
+        seq = Journal_Read_Seq(offset);
+        if((seq >> 8) == 0xFF)
+        {
+            continue;           // 空位或撕裂写入
+        }
+        // 15位循环序号比较：差值落在前半圈即为更新
+        if(last_offset == JOURNAL_SIZE ||
+           (uint16_t)((seq - last_seq) & JOURNAL_SEQ_MASK) < 0x4000)
+        {
+            last_seq = seq;
+            last_offset = offset;
+        }
+    }
+
+    if(last_offset == JOURNAL_SIZE)
+    {
+        journal_seq = 0;
+        journal_write_addr = 0;
+    }
+    else
+    {
+        journal_seq = (last_seq + 1) & JOURNAL_SEQ_MASK;
+        journal_write_addr = last_offset + JOURNAL_REC_SIZE;
+        // 跳过最新记录之后的撕裂写入残留（未擦除无法覆盖）
+        while(journal_write_addr % IAP_SECTOR_SIZE != 0 &&
+              !Journal_Slot_Erased(journal_write_addr))
+        {
+            journal_write_addr += JOURNAL_REC_SIZE;
+        }
+        if(journal_write_addr >= JOURNAL_SIZE)
+        {
+            journal_write_addr = 0;
+        }
+    }
+    journal_ready = 1;
+}
+
+// 暂存记录批量写入EEPROM：到达扇区起点时先擦除该扇区（覆盖最旧数据，扇区轮换）
+// 擦除/编程会暂停CPU数毫秒，只能在掉电前或主循环空闲点调用；
+// 仅危急档或ADC测得电压低于IAP最低电压时不写入（节能档照常写入，记录保留在RAM中待电压恢复）
+void Journal_Flush(void)
+{
+    uint8_t i, j;
+    uint16_t addr;
+    __xdata uint8_t *src;
+
+    if(journal_ram_count == 0 || power_band == POWER_BAND_CRITICAL ||
+       (volt_adc_valid && volt_adc_mv < IAP_MIN_MV))
+    {
+        return;
+    }
+    if(!journal_ready)
+    {
+        Journal_Recover();
+    }
+
+    for(i = 0; i < journal_ram_count; i++)
+    {
+        if(journal_write_addr % IAP_SECTOR_SIZE == 0)
+        {
+            IAP_Erase_Sector(JOURNAL_BASE_ADDR + journal_write_addr);
+        }
+        journal_ram[i].seq = journal_seq;
+        addr = JOURNAL_BASE_ADDR + journal_write_addr;
+        src = (__xdata uint8_t *)&journal_ram[i];
+        // 先写数据字节，最后写序号（低字节在前，高字节最后写入表示记录完整）
+        for(j = 2; j < JOURNAL_REC_SIZE; j++)
+        {
+            IAP_Write_Byte(addr + j, src[j]);
+        }
+        IAP_Write_Byte(addr, (uint8_t)journal_seq);
+        IAP_Write_Byte(addr + 1, (uint8_t)(journal_seq >> 8));
+
+        journal_seq = (journal_seq + 1) & JOURNAL_SEQ_MASK;
+        journal_write_addr += JOURNAL_REC_SIZE;
+        if(journal_write_addr >= JOURNAL_SIZE)
+        {
+            journal_write_addr = 0;
+        }
+    }
+    journal_ram_count = 0;
+}
+
+#ifdef CONSOLE_ENABLE
+// 串口导出全部日志：每行"seq,type,arg,value,time_s"，按EEPROM存放顺序输出，由上位机按seq排序
+void Journal_Dump(void)
+{
+    uint16_t offset, addr, seq;
+
+    Journal_Flush();
+    UART1_SendString("JOURNAL BEGIN\r\n");
+    for(offset = 0; offset < JOURNAL_SIZE; offset += JOURNAL_REC_SIZE)
+    {
+        seq = Journal_Read_Seq(offset);
+        if((seq >> 8) == 0xFF)
+        {
+            continue;
+        }
+        addr = JOURNAL_BASE_ADDR + offset;
+        UART1_SendNum(seq);
+        UART1_SendChar(',');
+        UART1_SendNum(IAP_Read_Byte(addr + 2));
+        UART1_SendChar(',');
+        UART1_SendNum(IAP_Read_Byte(addr + 3));
+        UART1_SendChar(',');
+        UART1_SendNum(((uint16_t)IAP_Read_Byte(addr + 5) << 8) | IAP_Read_Byte(addr + 4));
+        UART1_SendChar(',');
+        UART1_SendNum(((uint16_t)IAP_Read_Byte(addr + 7) << 8) | IAP_Read_Byte(addr + 6));
+        UART1_SendString("\r\n");
+        WDT_Task_Checkin(WDT_TASK_INPUT);
+        WDT_Task_Checkin(WDT_TASK_RULES);
+        WDT_Service();
+    }
+    UART1_SendString("JOURNAL END dropped=");
+    UART1_SendNum(journal_dropped);
+    UART1_SendString("\r\n");
+}
+#endif
+
+// 获取VCC电压（单位：mV）
+uint16_t Get_VCC_Voltage(void)
+{
+    uint16_t adc_val, voltage;
+    
+    // 转换阻塞等待：若转换不结束，主循环停止报到，由输入/规则任务监督触发复位
+    ADC_CONTR |= 0x40;          // 启动ADC转换
+    while(!(ADC_CONTR & 0x20)); // 等待转换完成
+    ADC_CONTR &= ~0x20;         // 清除转换完成标志
+    
+    // 计算12位ADC值
+    adc_val = (uint16_t)ADC_RES << 4;
+    adc_val |= ADC_RESL & 0x0F;
+    
+    // 电压计算公式：VCC = 参考电压 * 4096 / ADC值（除零保护）
+    if(adc_val != 0)
+    {
+        voltage = (uint32_t)REF_VOLTAGE * 4096 / adc_val;
+    }
+    else
+    {
+        voltage = 0; // 异常值处理
+    }
+    
+    return voltage;
+}
+
+// 检测电压状态并更新高低标记（调试模式串口输出电压值），测压后关闭ADC电源
+void Detect_Voltage_Status(void)
+{
+    uint32_t start_us = Get_Tick_us();
+    uint16_t volt = Get_VCC_Voltage();
+    
+    // 更新电压标记
+    if(volt < param[PARAM_VOLTAGE_THRESHOLD])
+    {
+        voltage_low_flag = 1;
+        voltage_high_flag = 0;
+    }
+    else
+    {
+        voltage_low_flag = 0;
+        voltage_high_flag = 1;
+    }
+    
+    Journal_Log(JOURNAL_EV_VOLTAGE, 0, volt);
+    TRACE_VOLT(volt);
+    Power_Governor_Update(volt);
+    Soc_Update(volt);
+    
+    ADC_Power_Off();
+    volt_adc_mv = volt;
+    volt_adc_pending = 0;
+    volt_adc_valid = 1;
+    volt_adc_last_s = Clock_Get_s();
+    adc_conv_count++;
+    volt_detect_us = (uint16_t)(Get_Tick_us() - start_us);
+    
+    // 调试模式：串口输出电压值
+#ifdef DEBUG_MODE
+    Print_Voltage(volt);
+#endif
+}
+
+// 安排后台测压：ADC上电满ADC_SETTLE_MS时由测压任务执行（已满则下一次Sched_Run执行）
+void Voltage_Schedule(void)
+{
+    uint16_t on_ms = (uint16_t)(Get_Tick_ms() - adc_on_tick);
+
+    Sched_Start(SCHED_TASK_VOLT, (on_ms < ADC_SETTLE_MS) ? ADC_SETTLE_MS - on_ms : 0);
+}
+
+// ADC电源开关：记录上电时刻，关闭时累计上电时间
+void ADC_Power_On(void)
+{
+    if(!adc_powered)
+    {
+        ADC_CONTR |= 0x80;
+        adc_on_tick = Get_Tick_ms();
+        adc_powered = 1;
+    }
+}
+
+void ADC_Power_Off(void)
+{
+    if(adc_powered)
+    {
+        ADC_CONTR &= ~0x80;
+        adc_on_ms_total += Get_Tick_ms() - adc_on_tick;
+        adc_powered = 0;
+    }
+}
+
+// LVD优先：正常档且LVD中断仍处于使能（本次唤醒未触发）时，LVD已回答"电压不低于3.0V"，
+// 仅在首次、遥测间隔到期、阈值高于LVD档位或非正常档（需测压判断升档）时才使用ADC
+bool Voltage_ADC_Needed(void)
+{
+#ifdef VOLTAGE_MONITOR_LVD
+    return (!volt_adc_valid || power_band != POWER_BAND_NORMAL || !power_lvd_armed ||
+            lvd_level_mv[RSTCFG & LVD_LEVEL_MASK] < param[PARAM_VOLTAGE_THRESHOLD] ||
+            Clock_Get_s() - volt_adc_last_s >= VOLT_TELEMETRY_S) ? true : false;
+#else
+    return true;
+#endif
+}
+
+// LVD未触发：电压不低于LVD档位（≥阈值），不上电ADC、不做除法
+void Voltage_From_LVD(void)
+{
+    if(power_band != POWER_BAND_NORMAL || !power_lvd_armed)
+    {
+        return;             // LVD刚触发：由主循环电源档位任务安排ADC测压
+    }
+    voltage_low_flag = 0;
+    voltage_high_flag = 1;
+    adc_skip_count++;
+#ifdef DEBUG_MODE
+    UART1_SendString("VCC >= LVD (ADC skipped)\r\n");
+#endif
+}
+
+/************************* Key脉冲（PCA硬件定时） *************************/
+// Key输出脚不在CCP引脚上，由比较匹配中断释放：CPU只在开始和结束时参与，
+// 脉冲宽度与主循环负载和其他中断无关（误差为PCA中断响应时间，数us）
+void PCA_Init(void)
+{
+    CCON = 0x00;                // 停止PCA，清除全部标志
+    CMOD = 0x00;                // SYSclk/12，空闲模式继续计数，关闭溢出中断
+    CL = 0;
+    CH = 0;
+    CCAPM0 = 0;                 // 模块0：全部通道共用的脉冲定时
+    key_pulse_active = 0;
+    key_pulse_done = 0;
+#ifdef PROFILE_MODE
+    Profile_Reset();
+    CR = 1;                     // 剖析构建：PCA作为自由计数器常开
+#endif
+}
+
+// 读取PCA计数：读CH后读CL，CH变化则重读
+uint16_t PCA_Read(void)
+{
+    uint8_t h, l;
+
+    do
+    {
+        h = CH;
+        l = CL;
+    } while(h != CH);
+    return ((uint16_t)h << 8) | l;
+}
+
+// 开始脉冲：宽度按PCA计数折算为整圈数+比较值；先按下Key再读计数，写CCAP0L清ECOM、写CCAP0H置ECOM
+bool Key_Pulse_Start(uint8_t ch)
+{
+    __code const chan_cfg_t *c = &chan_table[ch];
+    uint32_t counts = (uint32_t)param[c->pulse_param] * PCA_COUNTS_PER_MS;
+    uint16_t match;
+
+    if(key_pulse_active || key_pulse_done)
+    {
+        return false;           // 上一个脉冲尚未结束或尚未记录，本轮忽略（规则下一轮重新判断）
+    }
+    key_pulse_chan = ch;
+    key_pulse_ack = Chan_Feedback(ch) ? 0x02 : 0x00;
+    key_pulse_wraps = (uint8_t)(counts >> 16);
+    key_pulse_port = c->key_port;
+    key_pulse_mask = c->key_mask;
+    key_pulse_idle = !c->key_level;
+
+    WDT_Task_Begin(WDT_TASK_PULSE);
+    crumbs.last_state = CRUMB_PULSE;
+    CR = 1;
+    PORT_WRITE(c->key_port, c->key_mask, c->key_level);
+    match = PCA_Read() + (uint16_t)counts;
+    CCAP0L = (uint8_t)match;
+    CCAP0H = (uint8_t)(match >> 8);
+    CCAPM0 = PCA_CCAPM_TIMER;
+    key_pulse_active = 1;
+    Sched_Start(SCHED_TASK_PULSE, param[c->pulse_param] + 1);
+    return true;
+}
+
+// 脉冲结束后：读取脉冲后反馈并写日志，结束看门狗监督（按脉宽安排，PCA中断尚未结束脉冲则1ms后重试）
+// 同一时刻只有一个脉冲，中断置位done后不会再修改，无需关中断
+void Key_Pulse_Task(void)
+{
+    if(!key_pulse_done)
+    {
+        if(key_pulse_active)
+        {
+            Sched_Start(SCHED_TASK_PULSE, 1);
+        }
+        return;
+    }
+    Journal_Log(JOURNAL_EV_PULSE, key_pulse_chan + 1, key_pulse_ack | (Chan_Feedback(key_pulse_chan) ? 0x01 : 0x00));
+    key_pulse_done = 0;
+    WDT_Task_End(WDT_TASK_PULSE);
+}
+
+// 掉电前：释放全部Key并停止PCA（正常流程中掉电条件已要求无脉冲进行）
+void Key_Pulse_Abort(void)
+{
+    uint8_t ch;
+
+    CCAPM0 = 0;
+    PCA_IDLE_STOP();
+    for(ch = 0; ch < CHAN_COUNT; ch++)
+    {
+        PORT_WRITE(chan_table[ch].key_port, chan_table[ch].key_mask, !chan_table[ch].key_level);
+    }
+    if(key_pulse_active || key_pulse_done)
+    {
+        key_pulse_active = 0;
+        key_pulse_done = 0;
+        WDT_Task_End(WDT_TASK_PULSE);
+    }
+    Sched_Stop(SCHED_TASK_PULSE);
+}
+
+// 通道反馈线状态（1=打开/亮，0=关闭/灭）
+bool Chan_Feedback(uint8_t ch)
+{
+    uint8_t level = (PORT_READ(chan_table[ch].fb_port) & chan_table[ch].fb_mask) ? 1 : 0;
+
+    return (level == chan_table[ch].fb_on) ? 1 : 0;
+}
+
+// 通道目标状态：占用规则取融合后的占用状态；电压规则须本次唤醒已完成后台测压
+// 电压低（或放电趋势预计即将耗尽）→ 打开；电压高且无提前充电请求 → 关闭
+uint8_t Chan_Target(uint8_t ch)
+{
+    if(chan_table[ch].rule == CHAN_RULE_OCCUPANCY)
+    {
+        return (occupancy_state == OCC_PRESENT) ? CHAN_TARGET_ON : CHAN_TARGET_OFF;
+    }
+    if(!sensor_ready || volt_adc_pending)
+    {
+        return CHAN_TARGET_NONE;
+    }
+    if(voltage_low_flag || soc_charge_early)
+    {
+        return CHAN_TARGET_ON;
+    }
+    if(voltage_high_flag)
+    {
+        return CHAN_TARGET_OFF;
+    }
+    return CHAN_TARGET_NONE;
+}
+
+// 逐通道联动：解码状态与目标不符 → 输出Key脉冲（每通道固定开销，脉冲进行中的请求下一轮重新判断）
+// LED闪烁（模块配对/故障/确认中）或跳变后未稳定时保持现状，避免把闪烁的灭相当作关闭而多发脉冲
+void Linkage_Task(void)
+{
+    uint8_t ch, target, state;
+
+    for(ch = 0; ch < CHAN_COUNT; ch++)
+    {
+        target = Chan_Target(ch);
+        state = Chan_State(ch);
+        if(target != CHAN_TARGET_NONE && state != CHAN_TARGET_NONE && state != target)
+        {
+            Key_Pulse_Start(ch);
+        }
+    }
+}
+
+// 通道解码状态：非LED反馈直接取反馈线；LED反馈常亮/常灭为打开/关闭，闪烁为NONE
+uint8_t Chan_State(uint8_t ch)
+{
+    uint8_t led = chan_table[ch].fb_led;
+
+    if(led == CHAN_LED_NONE)
+    {
+        return Chan_Feedback(ch) ? CHAN_TARGET_ON : CHAN_TARGET_OFF;
+    }
+    switch(Led_State(led))
+    {
+    case LED_STATE_ON:
+        return CHAN_TARGET_ON;
+    case LED_STATE_OFF:
+        return CHAN_TARGET_OFF;
+    default:
+        return CHAN_TARGET_NONE;
+    }
+}
+
+/************************* LED闪烁解码 *************************/
+// 复位（唤醒上电时调用）：状态未知，按刚出现边沿处理，LED_STEADY_MS内无边沿才判定常亮/常灭
+// 不能假定已稳定：半周期长于就绪检测稳定时间的慢闪会被当作常亮/常灭而多发脉冲
+void Led_Decode_Reset(void)
+{
+    uint8_t i;
+    uint16_t now = (uint16_t)Get_Tick_ms();
+    bool et0_saved = ET0;
+
+    ET0 = 0;
+    led_lines_last = LED_LINES();
+    for(i = 0; i < LED_LINE_COUNT; i++)
+    {
+        led_edge_tick[i] = now;
+        led_half_ms[i] = LED_STEADY_MS;
+    }
+    ET0 = et0_saved;
+}
+
+// 分类：LED_STEADY_MS内无边沿 → 按电平常亮/常灭；否则按最近半周期分快闪/慢闪
+// 单次跳变（如本机脉冲切换了状态）在稳定LED_STEADY_MS前按慢闪处理
+uint8_t Led_State(uint8_t led)
+{
+    uint16_t now = (uint16_t)Get_Tick_ms();
+    uint16_t edge, half;
+    uint8_t level;
+    bool et0_saved = ET0;
+
+    ET0 = 0;                    // 16位时刻由中断写入，读取时屏蔽定时器0中断
+    edge = led_edge_tick[led];
+    half = led_half_ms[led];
+    level = (led_lines_last >> led) & 0x01;
+    ET0 = et0_saved;
+
+    if((uint16_t)(now - edge) >= LED_STEADY_MS)
+    {
+        return (level == LED_ON_LEVEL) ? LED_STATE_ON : LED_STATE_OFF;
+    }
+    return (half < LED_FAST_HALF_MS) ? LED_STATE_FAST : LED_STATE_SLOW;
+}
+
+// 禁用INT1中断（P3.3）- 防重复触发
+void Disable_INT1(void)
+{
+    EX1 = 0;
+}
+
+// 启用INT1中断（P3.3）- 恢复唤醒能力；清除屏蔽期间锁存的边沿（如PIR下降沿），避免掉电后立即误唤醒
+void Enable_INT1(void)
+{
+    IE1 = 0;
+    EX1 = 1;
+}
+
+/************************* 人员占用估计（雷达+PIR融合） *************************/
+// 唤醒时复位：PIR刚触发，PIR证据置满，雷达证据从零开始
+void Occupancy_Reset(void)
+{
+    occ_pir_evidence = 100;
+    occ_radar_evidence = 0;
+    occ_low_pending = 0;
+    occupancy_state = OCC_ABSENT;
+    occ_step_tick = (uint16_t)Get_Tick_ms();
+    Occupancy_Update();
+}
+
+// 按50ms步长累积证据：
+//   PIR漏检静坐人员 → PIR证据触发即满值并缓慢衰减，由雷达证据维持有人
+//   雷达存在误报     → 雷达证据缓慢增长且权重仅70%，短时误报不足以判定有人
+// 有人状态至少保持OCC_HOLD，置信度低于退出阈值持续OCC_CONFIRM后才判定无人
+void Occupancy_Update(void)
+{
+    uint16_t now = (uint16_t)Get_Tick_ms();
+    uint16_t conf;
+
+    while((uint16_t)(now - occ_step_tick) >= OCC_STEP_MS)
+    {
+        occ_step_tick += OCC_STEP_MS;
+
+        if(PIR_IN)
+        {
+            occ_pir_evidence = 100;
+        }
+        else if(occ_pir_evidence > OCC_PIR_DECAY)
+        {
+            occ_pir_evidence -= OCC_PIR_DECAY;
+        }
+        else
+        {
+            occ_pir_evidence = 0;
+        }
+
+        // 2410s启动期间输出无效；节能档仅用PIR检测
+        if(HUMAN_2410S_IN && sensor_ready && power_band == POWER_BAND_NORMAL)
+        {
+            occ_radar_evidence += OCC_RADAR_RISE;
+            if(occ_radar_evidence > 100)
+            {
+                occ_radar_evidence = 100;
+            }
+        }
+        else if(occ_radar_evidence > OCC_RADAR_DECAY)
+        {
+            occ_radar_evidence -= OCC_RADAR_DECAY;
+        }
+        else
+        {
+            occ_radar_evidence = 0;
+        }
+    }
+
+    conf = occ_pir_evidence + (uint16_t)occ_radar_evidence * OCC_RADAR_WEIGHT / 100;
+    occupancy_confidence = (conf > 100) ? 100 : (uint8_t)conf;
+
+    if(occupancy_state == OCC_ABSENT)
+    {
+        if(occupancy_confidence >= OCC_ENTER_LEVEL)
+        {
+            occupancy_state = OCC_PRESENT;
+            occ_enter_tick = now;
+            occ_low_pending = 0;
+            occ_hold_done = 0;
+            Journal_Log(JOURNAL_EV_OCCUPANCY, OCC_PRESENT, occupancy_confidence);
+        }
+        return;
+    }
+
+    // 最短保持满足后置位，避免16位计时回绕影响判断
+    if(!occ_hold_done && (uint16_t)(now - occ_enter_tick) >= param[PARAM_OCC_HOLD])
+    {
+        occ_hold_done = 1;
+    }
+    if(occupancy_confidence >= OCC_EXIT_LEVEL)
+    {
+        // 在学习延长的确认时间内重新检测到人：按固定窗口早已掉电，避免了一次掉电-唤醒
+        if(occ_low_pending && (uint16_t)(now - occ_low_tick) >= OCC_CONFIRM_MS)
+        {
+            adapt_rewake_avoided++;
+        }
+        occ_low_pending = 0;
+        return;
+    }
+    if(!occ_low_pending)
+    {
+        occ_low_pending = 1;
+        occ_low_tick = now;
+    }
+    if(occ_hold_done && (uint16_t)(now - occ_low_tick) >= param[PARAM_OCC_CONFIRM])
+    {
+        occupancy_state = OCC_ABSENT;
+        Journal_Log(JOURNAL_EV_OCCUPANCY, OCC_ABSENT, occupancy_confidence);
+    }
+}
+
+/************************* 唤醒后传感器就绪检测 *************************/
+// 读取就绪特征线：2410s输出 + HMBC09P的LED1/LED2/LED3状态线
+#define SENSOR_READY_LINES() \
+    ((uint8_t)HUMAN_2410S_IN | ((uint8_t)LED1_STATUS << 1) | \
+     ((uint8_t)LED2_STATUS << 2) | ((uint8_t)LED3_STATUS << 3))
+
+#define LIGHT_READY_MASK 0x0E   // 仅LED1/LED2/LED3状态线
+
+// 特征线稳定性跟踪：线值变化则记录变化时刻；至少min_ms且连续stable_ms无变化返回true
+bool Lines_Settled(uint8_t lines, uint16_t elapsed, uint16_t min_ms, uint16_t stable_ms)
+{
+    if(lines != settle_lines)
+    {
+        settle_lines = lines;
+        settle_stable_since = elapsed;
+        return false;
+    }
+    return (elapsed >= min_ms && (uint16_t)(elapsed - settle_stable_since) >= stable_ms);
+}
+
+// 唤醒快速路径：开灯只需HMBC09P响应按键，不等待2410s和测压
+// HMBC09P的LED线稳定（通常数十ms）后，若LED1未亮立即输出Key1脉冲，记录唤醒到开灯耗时
+void Wake_Light_Fast(void)
+{
+    uint16_t elapsed = 0;
+
+    settle_lines = SENSOR_READY_LINES() & LIGHT_READY_MASK;
+    settle_stable_since = 0;
+    while(elapsed < LIGHT_READY_MAX_MS &&
+          !Lines_Settled(SENSOR_READY_LINES() & LIGHT_READY_MASK, elapsed,
+                         LIGHT_READY_MIN_MS, LIGHT_READY_STABLE_MS))
+    {
+        elapsed = (uint16_t)(Get_Tick_ms() - wake_tick);
+    }
+
+    if(Chan_Feedback(CHAN_LIGHT) == 0)
+    {
+        light_latency_last_ms = (uint16_t)(Get_Tick_ms() - wake_pir_tick); // 含唤醒确认时间
+        if(light_latency_last_ms > light_latency_max_ms)
+        {
+            light_latency_max_ms = light_latency_last_ms;
+        }
+        Key_Pulse_Start(CHAN_LIGHT);
 #ifdef DEBUG_MODE
-    ES = 0;       // 调试模式：关闭串口中断
+        UART1_SendString("Wake to light: ");
+        UART1_SendNum(light_latency_last_ms);
+        UART1_SendString(" ms\r\n");
 #endif
-    EX1 = 1;      // 保留INT1中断
-    
-    // 置位PD位进入掉电模式，等待INT1中断唤醒
-    PCON |= 0x02;
-    NOP();
-    NOP();
-    
-    // 唤醒后恢复定时器和中断
-    ET0 = 1;
-    TR0 = 1;
-    EA = 1;
-    EX0 = 1;
-    IE2 |= 0x80;
+    }
+}
+
+// 开始后台就绪检测（计时从电源打开时刻起算）
+void Sensor_Ready_Start(void)
+{
+    sensor_ready = 0;
+    settle_lines = SENSOR_READY_LINES();
+    settle_stable_since = (uint16_t)(Get_Tick_ms() - wake_tick);
+}
+
+// 后台就绪检测：打开电源后，2410s输出和HMBC09P的LED线在启动期间会跳变；
+// 至少READY_MIN_MS，且全部特征线连续READY_STABLE_MS无变化即判定就绪，timeout_ms为上限
+// 就绪或超时时记录耗时统计和事件日志，置位sensor_ready并返回true
+bool Sensor_Ready_Poll(uint16_t timeout_ms)
+{
+    uint16_t elapsed = (uint16_t)(Get_Tick_ms() - wake_tick);
+    bool timed_out = (elapsed >= timeout_ms);
+
+    if(!Lines_Settled(SENSOR_READY_LINES(), elapsed, READY_MIN_MS, READY_STABLE_MS) && !timed_out)
+    {
+        return false;
+    }
+
+    sensor_ready = 1;
+    settle_last_ms = elapsed;
+    if(elapsed < settle_min_ms) settle_min_ms = elapsed;
+    if(elapsed > settle_max_ms) settle_max_ms = elapsed;
+    if(timed_out)
+    {
+        settle_timeout_count++;
+    }
+    Journal_Log(JOURNAL_EV_SETTLE, timed_out, elapsed);
 #ifdef DEBUG_MODE
-    ES = 1;       // 调试模式：恢复串口中断
+    UART1_SendString("Sensor settle: ");
+    UART1_SendNum(elapsed);
+    UART1_SendString(timed_out ? " ms (timeout)\r\n" : " ms\r\n");
 #endif
+    return true;
 }
 
-// 获取VCC电压（单位：mV）
-uint16_t Get_VCC_Voltage(void)
+/************************* 电源管理（电压分档） *************************/
+// 按测得电压选择档位：降档立即生效，升档须高于阈值回差后才生效
+void Power_Governor_Update(uint16_t volt)
 {
-    uint16_t adc_val, voltage;
-    
-    ADC_CONTR |= 0x40;          // 启动ADC转换
-    while(!(ADC_CONTR & 0x20)); // 等待转换完成
-    ADC_CONTR &= ~0x20;         // 清除转换完成标志
-    
-    // 计算12位ADC值
-    adc_val = (uint16_t)ADC_RES << 4;
-    adc_val |= ADC_RESL & 0x0F;
-    
-    // 电压计算公式：VCC = 参考电压 * 4096 / ADC值（除零保护）
-    if(adc_val != 0)
+    uint8_t band;
+    uint16_t conserve_mv = param[PARAM_VOLTAGE_THRESHOLD];
+
+    if(volt < POWER_CRITICAL_MV)
     {
-        voltage = (uint32_t)REF_VOLTAGE * 4096 / adc_val;
+        band = POWER_BAND_CRITICAL;
+    }
+    else if(volt < conserve_mv)
+    {
+        band = (power_band == POWER_BAND_CRITICAL && volt < POWER_CRITICAL_MV + POWER_HYSTERESIS_MV) ?
+               POWER_BAND_CRITICAL : POWER_BAND_CONSERVE;
     }
     else
     {
-        voltage = 0; // 异常值处理
+        band = (power_band != POWER_BAND_NORMAL && volt < conserve_mv + POWER_HYSTERESIS_MV) ?
+               POWER_BAND_CONSERVE : POWER_BAND_NORMAL;
     }
-    
-    return voltage;
+
+    if(band != power_band)
+    {
+        power_band = band;
+        Journal_Log(JOURNAL_EV_POWER_BAND, band, 0);
+#ifdef DEBUG_MODE
+        UART1_SendString("Power band: ");
+        UART1_SendNum(band);
+        UART1_SendString("\r\n");
+#endif
+    }
+    Power_LVD_Arm(band);
 }
 
-// 检测电压状态并更新高低标记（调试模式串口输出电压值）
-void Detect_Voltage_Status(void)
+// LVD按档位布防：正常档按不高于电压阈值的最高档位（阈值低于LVD档位时不会在阈值之上反复触发），
+// 节能档2.7V（触发→危急），危急档关闭
+// 已按该电平布防时不改写（避免清除尚未响应的LVDF）；改写电平前关中断，防止切换瞬间误触发
+void Power_LVD_Arm(uint8_t band)
 {
-    uint16_t volt = Get_VCC_Voltage();
-    
-    // 更新电压标记
-    if(volt < VOLTAGE_THRESHOLD)
+    uint8_t level = LVD_LEVEL_CRITICAL;
+
+    if(band == POWER_BAND_NORMAL)
     {
-        voltage_low_flag = 1;
-        voltage_high_flag = 0;
+        level = LVD_LEVEL_3V0;
+        while(level > 0 && lvd_level_mv[level] > param[PARAM_VOLTAGE_THRESHOLD])
+        {
+            level--;
+        }
     }
-    else
+    if(band == POWER_BAND_CRITICAL)
     {
-        voltage_low_flag = 0;
-        voltage_high_flag = 1;
+        ELVD = 0;
+        power_lvd_armed = 0;
+        return;
     }
-    
-    // 调试模式：串口输出电压值
+    if(power_lvd_armed && (RSTCFG & LVD_LEVEL_MASK) == level)
+    {
+        return;
+    }
+    ELVD = 0;
+    RSTCFG = (RSTCFG & ~LVD_LEVEL_MASK) | level;
+    PCON &= ~LVDF;
+    power_lvd_armed = 1;
+    ELVD = 1;
+}
+
+// 主循环调用：累计当前档位时间；记录LVD中断引起的档位变化
+void Power_Governor_Task(void)
+{
+    uint32_t now = Get_Tick_ms();
+
+    power_band_time_ms[power_band] += now - power_band_tick;
+    power_band_tick = now;
+
+    if(power_band_changed)
+    {
+        power_band_changed = 0;
+        Journal_Log(JOURNAL_EV_POWER_BAND, power_band, 1);
+        // LVD状态变化：上电ADC，稳定后由测压任务确认（传感器尚未就绪时由就绪检测安排）
+        ADC_Power_On();
+        volt_adc_pending = 1;
+        if(sensor_ready)
+        {
+            Voltage_Schedule();
+        }
 #ifdef DEBUG_MODE
-    Print_Voltage(volt);
+        UART1_SendString("LVD: power band ");
+        UART1_SendNum(power_band);
+        UART1_SendString("\r\n");
 #endif
+    }
+}
+
+// 危急档：切断传感器电源（调试模式同样执行），不写EEPROM，恢复INT1后立即掉电
+void Power_Shed_Sleep(void)
+{
+    POWER_CTRL = POWER_OFF_LEVEL;
+    sensor_ready = 0;
+    Enable_INT1();
+    WDT_Feed();
+    Crumb_State(CRUMB_SLEEP);
+    Enter_PowerDown_Mode();
+}
+
+/************************* 中断剖析（仅剖析构建） *************************/
+#ifdef PROFILE_MODE
+void Profile_Reset(void)
+{
+    uint8_t i;
+    bool ea_saved = EA;
+
+    EA = 0;
+    for(i = 0; i < PROF_SRC_COUNT; i++)
+    {
+        prof_lat[i].min = 0xFFFF;
+        prof_lat[i].max = 0;
+        prof_lat[i].sum = 0;
+        prof_lat[i].count = 0;
+        prof_exec[i] = prof_lat[i];
+    }
+    prof_t0_period = prof_lat[0];
+    prof_t0_valid = 0;
+    EA = ea_saved;
 }
 
-// Key1输出0.05秒低脉冲（定时器延时）
-void Output_Key1_Pulse(void)
+// 输出一项统计"名称=最小/平均/最大"，单位ns（scale_num/scale_den为每计数ns数）
+void Profile_Print_Stat(char *name, __xdata prof_stat_t *st, uint16_t scale_num, uint8_t scale_den)
 {
-    KEY1_OUT = 0;
-    Timer_Delay_ms(DELAY_KEY_PULSE);
-    KEY1_OUT = 1;
+    prof_stat_t copy;
+
+    EA = 0;                     // 中断会更新统计，复制时关中断
+    copy = *st;
+    EA = 1;
+    UART1_SendString(name);
+    UART1_SendChar('=');
+    if(copy.count == 0)
+    {
+        UART1_SendString("- ");
+        return;
+    }
+    UART1_SendNum((uint32_t)copy.min * scale_num / scale_den);
+    UART1_SendChar('/');
+    UART1_SendNum(copy.sum / copy.count * scale_num / scale_den);
+    UART1_SendChar('/');
+    UART1_SendNum((uint32_t)copy.max * scale_num / scale_den);
+    UART1_SendChar(' ');
 }
 
-// Key2输出0.05秒低脉冲（定时器延时）
-void Output_Key2_Pulse(void)
+// 每个中断源一行：n=次数 lat=入口延迟 exec=执行时间（ns，最小/平均/最大）；最后一行为Timer0节拍周期
+void Profile_Dump(void)
 {
-    KEY2_OUT = 0;
-    Timer_Delay_ms(DELAY_KEY_PULSE);
-    KEY2_OUT = 1;
+    uint8_t i;
+
+    UART1_SendString("PROFILE ns min/mean/max\r\n");
+    for(i = 0; i < PROF_SRC_COUNT; i++)
+    {
+        UART1_SendString((char *)prof_src_name[i]);
+        UART1_SendString(" n=");
+        UART1_SendNum(prof_exec[i].count);
+        UART1_SendChar(' ');
+        if(i == PROF_SRC_TIMER0)
+        {
+            Profile_Print_Stat("lat", &prof_lat[i], 1000, FOSC / 1000000);   // 定时器0计数：1/24us
+        }
+        else if(i == PROF_SRC_PCA)
+        {
+            Profile_Print_Stat("lat", &prof_lat[i], 1000 * PCA_CLK_DIV / (FOSC / 1000000), 1);
+        }
+        Profile_Print_Stat("exec", &prof_exec[i], 1000 * PCA_CLK_DIV / (FOSC / 1000000), 1);
+        UART1_SendString("\r\n");
+    }
+    Profile_Print_Stat("T0 period", &prof_t0_period, 1000 * PCA_CLK_DIV / (FOSC / 1000000), 1);
+    UART1_SendString("\r\n");
 }
+#endif
 
-// Key3输出0.05秒低脉冲（定时器延时）
-void Output_Key3_Pulse(void)
+/************************* 电池电量估计 *************************/
+// 放电曲线分段线性插值（16位运算：电压段差≤100mV，电量段差≤250）
+uint16_t Soc_From_Voltage(uint16_t volt)
 {
-    KEY3_OUT = 0;
-    Timer_Delay_ms(DELAY_KEY_PULSE);
-    KEY3_OUT = 1;
+    uint8_t i;
+
+    if(volt >= soc_curve_mv[0])
+    {
+        return soc_curve_pm[0];
+    }
+    for(i = 1; i < SOC_CURVE_POINTS; i++)
+    {
+        if(volt >= soc_curve_mv[i])
+        {
+            return soc_curve_pm[i] + (volt - soc_curve_mv[i]) * (soc_curve_pm[i - 1] - soc_curve_pm[i]) /
+                   (soc_curve_mv[i - 1] - soc_curve_mv[i]);
+        }
+    }
+    return 0;
 }
 
-// 检测LED1状态（1=亮，0=灭）
-bool Check_LED1_Status(void)
+// 每次测压后调用：滤波电压 → 电量；按系统时钟间隔估计放电速率和剩余天数
+// 电量回升（充电中）时重新建立起点，速率保持上次估计值
+void Soc_Update(uint16_t volt)
 {
-    return (LED1_STATUS == LED_ON_LEVEL) ? 1 : 0;
+    uint32_t now = Clock_Get_s();
+    uint32_t dt;
+    uint16_t rate;
+
+    soc_vcc_x4 = (soc_vcc_x4 == 0) ? volt * 4 : soc_vcc_x4 - soc_vcc_x4 / 4 + volt;
+    soc_permille = Soc_From_Voltage(soc_vcc_x4 / 4);
+
+    if(!soc_anchor_valid || soc_permille > soc_anchor_pm)
+    {
+        soc_anchor_pm = soc_permille;
+        soc_anchor_s = now;
+        soc_anchor_valid = 1;
+    }
+    else
+    {
+        dt = now - soc_anchor_s;
+        if(dt >= SOC_RATE_WINDOW_S ||
+           (dt >= SOC_RATE_MIN_S && soc_anchor_pm - soc_permille >= SOC_RATE_MIN_DROP))
+        {
+            rate = (uint16_t)((uint32_t)(soc_anchor_pm - soc_permille) * 86400UL / dt);
+            soc_rate_pm_day = (soc_rate_pm_day == 0) ? rate : (soc_rate_pm_day * 3 + rate) / 4;
+            soc_anchor_pm = soc_permille;
+            soc_anchor_s = now;
+            Journal_Log(JOURNAL_EV_SOC, (soc_days_left > 255) ? 255 : (uint8_t)soc_days_left, soc_permille);
+        }
+    }
+
+    soc_days_left = (soc_rate_pm_day != 0) ? soc_permille / soc_rate_pm_day : SOC_DAYS_UNKNOWN;
+
+    // 提前充电：按趋势预计剩余天数不足时开始，充到90%后交还电压规则
+    if(soc_days_left < SOC_CHARGE_EARLY_DAYS)
+    {
+        soc_charge_early = 1;
+    }
+    else if(soc_permille >= SOC_CHARGE_STOP_PM)
+    {
+        soc_charge_early = 0;
+    }
 }
 
-// 检测LED2状态（1=亮，0=灭）
-bool Check_LED2_Status(void)
+/************************* 无人确认时间自适应 *************************/
+// 掉电前：保存已变化的学习值，开启再入观察窗口（首个掉电唤醒定时器周期）
+void Adapt_Before_Sleep(void)
 {
-    return (LED2_STATUS == LED_ON_LEVEL) ? 1 : 0;
+    if(adapt_dirty && !voltage_low_flag)
+    {
+        Settings_Save(SETTING_ABSENCE_TIMEOUT, param[PARAM_OCC_CONFIRM]);
+        adapt_dirty = 0;
+    }
+    if(power_band != POWER_BAND_NORMAL)
+    {
+        return;                 // 节能档：不进行再入学习
+    }
+    adapt_window_open = 1;
 }
 
-// 检测Relay3状态（1=打开，0=关闭）
-bool Check_Relay3_Status(void)
+// 唤醒后：窗口内被PIR唤醒 → 刚离开的人又回来了，延长确认时间；
+//         窗口到期由定时器唤醒 → 确认时间足够，逐步缩短以节能
+void Adapt_After_Wake(void)
 {
-    return (RELAY3_FEEDBACK == RELAY3_OPEN_LEVEL) ? 1 : 0;
+    uint16_t val = param[PARAM_OCC_CONFIRM];
+
+    if(!adapt_window_open)
+    {
+        return;
+    }
+    adapt_window_open = 0;
+    if(maint_wakeup_flag)
+    {
+        return;                 // 维护唤醒打断了观察窗口：本次不调整
+    }
+
+    if(system_wakeup_flag)
+    {
+        adapt_reentry_count++;
+        val = (val > ADAPT_MAX_MS - ADAPT_STEP_UP_MS) ? ADAPT_MAX_MS : val + ADAPT_STEP_UP_MS;
+    }
+    else
+    {
+        val = (val < ADAPT_MIN_MS + ADAPT_STEP_DOWN_MS) ? ADAPT_MIN_MS : val - ADAPT_STEP_DOWN_MS;
+    }
+    if(val != param[PARAM_OCC_CONFIRM])
+    {
+        Journal_Log(JOURNAL_EV_ADAPT, system_wakeup_flag, val);
+        param[PARAM_OCC_CONFIRM] = val;
+        adapt_dirty = 1;
+    }
 }
 
-// 禁用INT1中断（P3.3）- 防重复触发
-void Disable_INT1(void)
+/************************* 设置存储（IAP EEPROM） *************************/
+// 记录格式：[标签][值低字节][值高字节][校验=标签^低^高^0xA5]，顺序追加，最新的有效记录生效
+bool Settings_Load(uint8_t tag, uint16_t *value)
 {
-    EX1 = 0;
+    uint16_t offset, addr;
+    uint8_t t, lo, hi;
+    bool found = false;
+
+    for(offset = 0; offset < IAP_SECTOR_SIZE; offset += SETTINGS_REC_SIZE)
+    {
+        addr = SETTINGS_ADDR + offset;
+        t = IAP_Read_Byte(addr);
+        if(t == 0xFF)
+        {
+            continue;           // 空位或未写完的记录（标签最后写入）
+        }
+        lo = IAP_Read_Byte(addr + 1);
+        hi = IAP_Read_Byte(addr + 2);
+        if(t == tag && IAP_Read_Byte(addr + 3) == (uint8_t)(t ^ lo ^ hi ^ 0xA5))
+        {
+            *value = ((uint16_t)hi << 8) | lo;
+            found = true;
+        }
+    }
+    return found;
 }
 
-// 启用INT1中断（P3.3）- 恢复唤醒能力
-void Enable_INT1(void)
+// 追加写入设置记录；扇区写满时擦除后重写（仅保存当前记录）
+void Settings_Save(uint8_t tag, uint16_t value)
 {
-    EX1 = 1;
+    uint16_t offset;
+    uint8_t lo = (uint8_t)value;
+    uint8_t hi = (uint8_t)(value >> 8);
+
+    // 从扇区末尾向前找到最后一条非空记录，其后即为追加位置（跳过未写完的残留）
+    for(offset = IAP_SECTOR_SIZE; offset > 0; offset -= SETTINGS_REC_SIZE)
+    {
+        if(IAP_Read_Byte(SETTINGS_ADDR + offset - SETTINGS_REC_SIZE) != 0xFF ||
+           IAP_Read_Byte(SETTINGS_ADDR + offset - SETTINGS_REC_SIZE + 1) != 0xFF ||
+           IAP_Read_Byte(SETTINGS_ADDR + offset - SETTINGS_REC_SIZE + 2) != 0xFF ||
+           IAP_Read_Byte(SETTINGS_ADDR + offset - SETTINGS_REC_SIZE + 3) != 0xFF)
+        {
+            break;
+        }
+    }
+    if(offset >= IAP_SECTOR_SIZE)
+    {
+        IAP_Erase_Sector(SETTINGS_ADDR);
+        offset = 0;
+    }
+    IAP_Write_Byte(SETTINGS_ADDR + offset + 1, lo);
+    IAP_Write_Byte(SETTINGS_ADDR + offset + 2, hi);
+    IAP_Write_Byte(SETTINGS_ADDR + offset + 3, (uint8_t)(tag ^ lo ^ hi ^ 0xA5));
+    IAP_Write_Byte(SETTINGS_ADDR + offset, tag);   // 标签最后写入，标志记录完整
 }
 
-// 检查掉电条件：P3.2（无人）+ P3.3（无PIR）均低
+// 检查掉电条件：确认无人 + P3.2（无人）+ P3.3（无PIR）均低
 bool Check_Exit_Condition(void)
 {
-    return (HUMAN_2410S_IN == 0 && PIR_IN == 0) ? true : false;
+    return (sensor_ready && occupancy_state == OCC_ABSENT && HUMAN_2410S_IN == 0 && PIR_IN == 0 &&
+            !key_pulse_active && !key_pulse_done) ? true : false;
+}
+
+// 占用估计+联动规则（每个证据步长运行）：融合2410s雷达与PIR证据，再逐通道求目标状态并输出Key脉冲
+void Sense_Task(void)
+{
+    Occupancy_Update();
+    Linkage_Task();
+    WDT_Task_Checkin(WDT_TASK_RULES);   // 规则判断任务报到（本次联动规则执行完毕）
+}
+
+// 掉电前延时到期：由主循环再次确认掉电条件后执行掉电流程
+void Power_Off_Task(void)
+{
+    power_off_due = 1;
 }
 
 /************************* 中断服务函数 *************************/
-// 定时器0中断服务函数（1ms一次）
+// 最坏响应延迟估算（24MHz，1T指令周期，含中断响应及同级/高级中断服务时间；硬件实测见剖析构建）：
+//   PCA    ≤ 1us   ：仅受最长单条指令及进入中断开销限制
+//   Timer0 ≤ 4us   ：另加PCA中断服务（约2us）；自动重载，延迟不影响节拍周期；入口压栈约1us
+//   INT1   ≤ 8us   ：另加Timer0中断服务（约3us，含压栈）及LVD
+//   LVD    ≤ 8us   ：同INT1
+//   UART1  ≤ 12us  ：另加全部高级中断一次；115200波特率每字节87us，不丢字节
+// 例外：IAP擦除/写入期间CPU暂停（擦除约4~6ms），所有中断推迟到IAP结束，
+//       Timer0溢出标志只保留一次，节拍最多丢失擦除时长；Journal_Flush只在无脉冲进行时调用
+// 定时器0中断服务函数（1ms一次，16位自动重载）
 void Timer0_ISR(void) __interrupt(1)
 {
-    // 重装定时器初值（模式1需要手动重装）
-    TH0 = (uint8_t)(TIMER0_RELOAD >> 8);
-    TL0 = (uint8_t)TIMER0_RELOAD;
-    
+    PROF_ENTER(prof_t);
+#ifdef PROFILE_MODE
+    {
+        // 入口延迟 = 自动重载后已计数值（1/24us）；节拍周期 = 相邻入口PCA计数差
+        uint8_t h;
+        uint16_t c;
+        do
+        {
+            h = TH0;
+            c = ((uint16_t)h << 8) | TL0;
+        } while(h != TH0);
+        c -= (uint16_t)TIMER0_RELOAD;
+        PROF_STAT(prof_lat[PROF_SRC_TIMER0], c);
+        if(prof_t0_valid)
+        {
+            c = prof_t - prof_t0_last;
+            PROF_STAT(prof_t0_period, c);
+        }
+        prof_t0_last = prof_t;
+        prof_t0_valid = 1;
+    }
+#endif
     timer_ms++; // 毫秒计数器累加
+    {
+        // LED状态线边沿时间戳（闪烁解码）：无边沿时仅一次端口读取和比较
+        uint8_t lines = LED_LINES();
+        uint8_t diff = lines ^ led_lines_last;
+
+        if(diff)
+        {
+            uint8_t i;
+
+            led_lines_last = lines;
+            for(i = 0; i < LED_LINE_COUNT; i++, diff >>= 1)
+            {
+                if(diff & 0x01)
+                {
+                    led_half_ms[i] = (uint16_t)timer_ms - led_edge_tick[i];
+                    led_edge_tick[i] = (uint16_t)timer_ms;
+                }
+            }
+        }
+    }
+#ifdef TRACE_MODE
+    if(trace_armed)
+    {
+        uint8_t lines = TRACE_LINES();
+
+        if(lines != trace_lines_last)
+        {
+            trace_lines_last = lines;
+            TRACE_PUSH(TRACE_EV_EDGE, timer_ms, lines);
+        }
+    }
+#endif
+    crumbs.last_isr = CRUMB_ISR_TIMER0;
+    PROF_EXIT(PROF_SRC_TIMER0, prof_t);
 }
 
 // INT1中断（P3.3上升沿）- 核心唤醒源
 void INT1_ISR(void) __interrupt(2)
 {
+    PROF_ENTER(prof_t);
     system_wakeup_flag = 1; // 置位唤醒标志
+    crumbs.last_isr = CRUMB_ISR_INT1;
     PCON &= ~0x02;          // 清除掉电模式标志，退出掉电
+    PROF_EXIT(PROF_SRC_INT1, prof_t);
+}
+
+// INT4中断（P3.0/RxD下降沿）- 维护唤醒：仅在掉电前开启，运行期间关闭
+#ifdef CONSOLE_ENABLE
+void INT4_ISR(void) __interrupt(16)
+{
+    PROF_ENTER(prof_t);
+    maint_wakeup_flag = 1;
+    AUXINTIF &= ~INT4IF;    // 清除INT4标志
+    crumbs.last_isr = CRUMB_ISR_INT4;
+    PROF_EXIT(PROF_SRC_INT4, prof_t);
 }
+#endif
 
 // INT0中断（P3.2下降沿）- 预留扩展
 void INT0_ISR(void) __interrupt(0)
 {
-    // 预留，暂无操作
+    PROF_ENTER(prof_t);
+    crumbs.last_isr = CRUMB_ISR_INT0;
+    PROF_EXIT(PROF_SRC_INT0, prof_t);
 }
 
-// LVD中断服务函数 - 预留扩展
-void LVD_ISR(void) __interrupt(26)
+// LVD中断服务函数（中断号6）：档位由触发电平决定（不递增），高于危急电压的档位（3.0V）→ 节能档并改为2.7V继续监视，
+// 低于危急电压的档位（≤2.7V）→ 危急档并直接切断传感器电源；电压已低于2.7V时改电平后立即再次触发
+// 危急档关闭LVD中断（电压持续偏低时LVDF会反复置位），由电源管理测压升档后重新布防
+void LVD_ISR(void) __interrupt(6)
 {
+    PROF_ENTER(prof_t);
+    crumbs.last_isr = CRUMB_ISR_LVD;
     if(PCON & LVDF)
     {
         voltage_low_flag = 1; // 标记低电压
-        PCON &= ~LVDF;        // 清除中断标志
+        voltage_high_flag = 0;
+        if((RSTCFG & LVD_LEVEL_MASK) > LVD_LEVEL_CRITICAL)
+        {
+            power_band = POWER_BAND_CONSERVE;
+            RSTCFG = (RSTCFG & ~LVD_LEVEL_MASK) | LVD_LEVEL_CRITICAL; // 节能档布防2.7V
+        }
+        else
+        {
+            power_band = POWER_BAND_CRITICAL;
+            POWER_CTRL = POWER_OFF_LEVEL;
+            power_lvd_armed = 0;
+            ELVD = 0;
+        }
+        PCON &= ~LVDF;        // 清除中断标志（改电平后再清，电压已低于新电平时会重新置位）
+        power_band_changed = 1;
     }
+    PROF_EXIT(PROF_SRC_LVD, prof_t);
 }
 
-// 串口1中断服务函数（仅调试模式编译，此处仅发送无需处理接收）
-#ifdef DEBUG_MODE
+// PCA中断（中断号7）：模块0比较匹配到达 → 未满整圈则继续等待，否则释放当前通道Key并停止模块
+// 比较值不变，每经过65536个计数匹配一次
+void PCA_ISR(void) __interrupt(7) __using(ISR_BANK_PCA)
+{
+    PROF_ENTER(prof_t);
+#ifdef PROFILE_MODE
+    // 入口延迟 = 当前计数 - 比较值
+    if(CCF0) PROF_STAT(prof_lat[PROF_SRC_PCA], (uint16_t)(prof_t - (((uint16_t)CCAP0H << 8) | CCAP0L)));
+#endif
+    crumbs.last_isr = CRUMB_ISR_PCA;
+    if(CCF0)
+    {
+        CCF0 = 0;
+        if(key_pulse_wraps != 0)
+        {
+            key_pulse_wraps--;
+        }
+        else
+        {
+            PORT_WRITE(key_pulse_port, key_pulse_mask, key_pulse_idle);
+            CCAPM0 = 0;
+            key_pulse_active = 0;
+            key_pulse_done = 1;
+        }
+    }
+    CF = 0;
+    if(!key_pulse_active)
+    {
+        PCA_IDLE_STOP();
+    }
+    PROF_EXIT(PROF_SRC_PCA, prof_t);
+}
+
+// 串口2中断（中断号8）：遥测发送缓冲区下一个字节，缓冲区空则停止（不接收）
+void UART2_ISR(void) __interrupt(8)
+{
+    PROF_ENTER(prof_t);
+    crumbs.last_isr = CRUMB_ISR_UART2;
+    if(S2CON & S2TI)
+    {
+        S2CON &= ~S2TI;
+        if(tlm_tx_tail != tlm_tx_head)
+        {
+            S2BUF = tlm_tx_buf[tlm_tx_tail];
+            tlm_tx_tail = (tlm_tx_tail + 1) & (TLM_TX_BUF_SIZE - 1);
+        }
+        else
+        {
+            tlm_tx_busy = 0;
+        }
+    }
+    if(S2CON & S2RI)
+    {
+        S2CON &= ~S2RI;
+    }
+    PROF_EXIT(PROF_SRC_UART2, prof_t);
+}
+
+// 串口1中断服务函数（调试模式/维护串口编译）
+#ifdef CONSOLE_ENABLE
 void UART1_ISR(void) __interrupt(4)
 {
-    if(RI) // 接收中断（预留）
+    uint8_t next;
+    PROF_ENTER(prof_t);
+
+    crumbs.last_isr = CRUMB_ISR_UART1;
+
+    if(RI) // 接收中断：存入接收缓冲区，满则丢弃
     {
         RI = 0; // 清除接收标志
+        next = (uart_rx_head + 1) & (UART_RX_BUF_SIZE - 1);
+        if(next != uart_rx_tail)
+        {
+            uart_rx_buf[uart_rx_head] = SBUF;
+            uart_rx_head = next;
+        }
     }
-    if(TI) // 发送中断（自动清除，此处预留）
+    if(TI) // 发送中断：发送缓冲区下一个字节，缓冲区空则停止
     {
         TI = 0;
+        if(uart_tx_tail != uart_tx_head)
+        {
+            SBUF = uart_tx_buf[uart_tx_tail];
+            uart_tx_tail = (uart_tx_tail + 1) & (UART_TX_BUF_SIZE - 1);
+        }
+        else
+        {
+            uart_tx_busy = 0;
+        }
     }
+    PROF_EXIT(PROF_SRC_UART1, prof_t);
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,21 @@
+#!/bin/sh
+# 同一轨迹回放到三个固件版本，输出对比表
+# 用法：./compare.sh <轨迹文件> [公共选项...]   （公共选项见README.md，例如电流假设）
+# 各版本按其源文件中的电平配置设置板级参数：
+#   main.c          P5.5低电平开电源，LED低亮，Relay高电平打开
+#   main.2.22.c     POWER_CTRL_MODE=1（高电平开电源），LED高亮，Relay高电平打开
+#   deepseek版本    P5.5拉低开电源，继电器反馈高电平打开（不读LED）
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "用法：$0 <轨迹文件> [公共选项...]" >&2
+    exit 2
+fi
+trace=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+shift
+cd "$(dirname "$0")"
+make -s all
+
+./build/replay_main     --header --name main.c      --power-on-level 0 --led-on-level 0 --relay-on-level 1 "$@" "$trace"
+./build/replay_v222     --name main.2.22.c --power-on-level 1 --led-on-level 1 --relay-on-level 1 "$@" "$trace"
+./build/replay_deepseek --name deepseek    --power-on-level 0 --led-on-level 0 --relay-on-level 1 "$@" "$trace"
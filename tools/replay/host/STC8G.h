@@ -0,0 +1,11 @@
+/**************************************************************************************
+ * 主机回放构建用STC8G.h
+ * include/STC8G.h的寄存器定义与STC8Fxx.h完全重复：C中为重复的暂定定义，C++中为重定义错误，
+ * 因此主机构建只包含STC8Fxx.h（内容相同）
+ **************************************************************************************/
+#ifndef STC8G_H
+#define STC8G_H
+
+#include "STC8Fxx.h"
+
+#endif
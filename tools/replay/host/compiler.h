@@ -0,0 +1,83 @@
+/**************************************************************************************
+ * 主机回放构建用compiler.h（替代SDCC的<compiler.h>，由STC8Fxx.h包含）
+ * 固件源文件按C++编译：SFR/SBIT映射为带副作用的寄存器访问对象，
+ * 每次读写交给仿真器（sim.cpp）处理定时器、中断、掉电、ADC、IAP等外设行为
+ **************************************************************************************/
+#ifndef HOST_COMPILER_H
+#define HOST_COMPILER_H
+
+#include <stdint.h>
+#include "sim.h"
+
+// 8位特殊功能寄存器：读返回引脚/寄存器值，写交给仿真器；复合赋值按读-改-写处理（端口读锁存器）
+class HostSfr
+{
+public:
+    explicit HostSfr(uint8_t addr) : a(addr) {}
+    operator uint8_t() const { return host_sfr_read(a); }
+    HostSfr &operator=(unsigned v) { host_sfr_write(a, (uint8_t)v); return *this; }
+    HostSfr &operator=(const HostSfr &o) { host_sfr_write(a, (uint8_t)o); return *this; }
+    HostSfr &operator|=(unsigned v) { host_sfr_write(a, (uint8_t)(host_sfr_latch(a) | v)); return *this; }
+    HostSfr &operator&=(unsigned v) { host_sfr_write(a, (uint8_t)(host_sfr_latch(a) & v)); return *this; }
+    HostSfr &operator^=(unsigned v) { host_sfr_write(a, (uint8_t)(host_sfr_latch(a) ^ v)); return *this; }
+    HostSfr &operator+=(unsigned v) { host_sfr_write(a, (uint8_t)(host_sfr_latch(a) + v)); return *this; }
+    HostSfr &operator-=(unsigned v) { host_sfr_write(a, (uint8_t)(host_sfr_latch(a) - v)); return *this; }
+    HostSfr &operator++() { return *this += 1; }
+    HostSfr &operator--() { return *this -= 1; }
+    uint8_t operator++(int) { uint8_t v = host_sfr_latch(a); *this += 1; return v; }
+    uint8_t operator--(int) { uint8_t v = host_sfr_latch(a); *this -= 1; return v; }
+private:
+    uint8_t a;
+};
+
+// 可位寻址寄存器的位
+class HostSbit
+{
+public:
+    HostSbit(uint8_t addr, uint8_t bit) : a(addr), m((uint8_t)(1 << bit)) {}
+    operator bool() const { return (host_sfr_read(a) & m) != 0; }
+    HostSbit &operator=(unsigned v)
+    {
+        uint8_t r = host_sfr_latch(a);
+        host_sfr_write(a, v ? (uint8_t)(r | m) : (uint8_t)(r & ~m));
+        return *this;
+    }
+    HostSbit &operator=(const HostSbit &o) { return *this = (unsigned)(bool)o; }
+private:
+    uint8_t a;
+    uint8_t m;
+};
+
+// 中断向量登记（tools/replay/Makefile把“void X(void) __interrupt(n)”改写为HOST_ISR(n, X)）
+class HostIsr
+{
+public:
+    HostIsr(uint8_t vector, void (*isr)(void)) { host_isr_register(vector, isr); }
+};
+
+#define SFR(name, addr)        static HostSfr name(addr)
+#define SBIT(name, addr, bit)  static HostSbit name(addr, bit)
+#define HOST_ISR(vector, name) void name(void); static HostIsr host_isr_##name(vector, name); void name(void)
+
+// SDCC存储类型及函数属性：主机上无意义
+#define __interrupt(n)
+#define __using(n)
+#define __critical
+#define __reentrant
+#define __naked
+#define __bit   bool
+#define __data
+#define __idata
+#define __pdata
+#define __xdata
+#define __code
+#define __near
+#define __far
+#define __at(addr)
+
+// 空操作：计入一个时钟周期（STC8Fxx.h的内联汇编版本不参与编译）
+#define _NOP_DEFINED
+static inline void _nop_(void) { host_cycles(1); }
+#define NOP() _nop_()
+
+#endif
@@ -0,0 +1,15 @@
+/**************************************************************************************
+ * 回放仿真器接口（固件一侧经compiler.h调用）
+ **************************************************************************************/
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdint.h>
+
+uint8_t host_sfr_read(uint8_t addr);                      // 读寄存器（端口返回引脚电平）
+uint8_t host_sfr_latch(uint8_t addr);                     // 读寄存器锁存值（读-改-写指令）
+void host_sfr_write(uint8_t addr, uint8_t val);           // 写寄存器（触发外设行为）
+void host_cycles(uint32_t n);                             // 推进仿真时间（系统时钟周期）
+void host_isr_register(uint8_t vector, void (*isr)(void)); // 登记中断服务函数
+
+#endif
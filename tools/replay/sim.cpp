@@ -0,0 +1,1141 @@
+/**************************************************************************************
+ * 输入轨迹回放仿真器：把固件输出的轨迹（W/E/V记录）回放到主机编译的固件版本上，
+ * 统计唤醒次数、Key脉冲数、运行时间、能耗估计及唤醒到开灯延迟
+ *
+ * 时间模型：固件按-fsanitize-coverage=trace-pc编译，每执行一个基本块推进--bb-cycles个系统时钟，
+ *           _nop_()另计1个时钟；掉电期间直接跳到下一个唤醒源（输入边沿/唤醒定时器）
+ * 外设模型：Timer0（16位自动重载）、INT0/INT1（IT=0双边沿，IT=1下降沿）、掉电唤醒定时器、
+ *           ADC CH15（内部参考电压）、LVD、PCA模块0~2比较匹配/溢出、串口1/串口2发送、IAP EEPROM、空闲/掉电模式
+ * 外部模型：PIR按轨迹；2410s雷达按轨迹（仅电源打开时有输出）；HMBC09P三路通道：
+ *           电源打开时Key被拉低不少于--key-min-ms，释放时翻转对应通道，通道驱动LED/继电器反馈
+ * 引脚漏电：高阻输入无外部驱动（悬空）计--i-float-ua；模块断电时Key推挽高经保护二极管倒灌计--i-backfeed-ua，
+ *           准双向高（弱上拉）计--i-weak-ua；统计掉电期间平均电流（sleep_uA）
+ * 未建模：看门狗复位、中断优先级嵌套、定时器1/2（仅作波特率）、串口接收
+ **************************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "sim.h"
+
+void fw_main(void);  // 固件main()（构建时以-Dmain=fw_main改名）
+
+#define FOSC            24000000ULL
+#define NEVER           UINT64_MAX
+#define MS_CYCLES       (FOSC / 1000)
+#define WKT_TICK_NS     488281ULL     // 掉电唤醒定时器计数周期（32kHz/16）
+#define EEPROM_SIZE     4096
+#define EEPROM_SECTOR   512
+#define IAP_ERASE_US    4000          // 扇区擦除期间CPU停止
+#define IAP_WRITE_US    40
+
+// 特殊功能寄存器地址
+#define A_P1        0x90
+#define A_P1M1      0x91
+#define A_P1M0      0x92
+#define A_P3        0xB0
+#define A_P3M1      0xB1
+#define A_P3M0      0xB2
+#define A_P5        0xC8
+#define A_P5M1      0xC9
+#define A_P5M0      0xCA
+#define A_PCON      0x87
+#define A_TCON      0x88
+#define A_TL0       0x8A
+#define A_TH0       0x8C
+#define A_AUXR      0x8E
+#define A_SCON      0x98
+#define A_SBUF      0x99
+#define A_S2CON     0x9A
+#define A_S2BUF     0x9B
+#define A_IE        0xA8
+#define A_WKTCL     0xAA
+#define A_WKTCH     0xAB
+#define A_IE2       0xAF
+#define A_ADC_CONTR 0xBC
+#define A_ADC_RES   0xBD
+#define A_ADC_RESL  0xBE
+#define A_IAP_DATA  0xC2
+#define A_IAP_ADDRH 0xC3
+#define A_IAP_ADDRL 0xC4
+#define A_IAP_CMD   0xC5
+#define A_IAP_TRIG  0xC6
+#define A_IAP_CONTR 0xC7
+#define A_CCON      0xD8
+#define A_CMOD      0xD9
+#define A_CCAPM0    0xDA
+#define A_CL        0xE9
+#define A_CCAP0L    0xEA
+#define A_CH        0xF9
+#define A_CCAP0H    0xFA
+#define A_RSTCFG    0xFF
+
+// 端口及外部连接
+enum { PORT1, PORT3, PORT5, PORT_COUNT };
+#define EXT_Z       (-1)    // 外部未驱动
+#define CHAN_COUNT  3
+static const uint8_t port_bonded[PORT_COUNT] = { 0xFF, 0xFF, 0x30 };  // 封装引出的引脚（P1、P3全部，P5.4/P5.5）
+
+struct pin_ref { uint8_t port, bit; };
+static const uint8_t port_addr[PORT_COUNT] = { A_P1, A_P3, A_P5 };
+static const pin_ref PIN_PIR = { PORT3, 3 }, PIN_RADAR = { PORT3, 2 }, PIN_POWER = { PORT5, 5 };
+static const pin_ref PIN_KEY[CHAN_COUNT]   = { { PORT5, 4 }, { PORT1, 7 }, { PORT1, 5 } };
+static const pin_ref PIN_LED[CHAN_COUNT]   = { { PORT3, 4 }, { PORT3, 5 }, { PORT1, 3 } };
+static const pin_ref PIN_RELAY[CHAN_COUNT] = { { PORT3, 6 }, { PORT3, 7 }, { PORT1, 4 } };
+
+// 轨迹事件（回放输入）
+enum { EV_PIR, EV_RADAR, EV_VCC };
+#define PIR_SPURIOUS  0     // 误唤醒脉冲
+#define PIR_SESSION   1     // 确认唤醒（新一轮有人）
+#define PIR_INSESSION 2     // 唤醒期间的边沿
+struct trace_ev { uint64_t t; uint8_t type; uint8_t tag; uint16_t val; };
+
+// 参数（命令行）
+static struct
+{
+    const char *name = "fw";
+    uint32_t bb_cycles = 3;
+    int power_on_level = 0;
+    int led_on_level = 0;
+    int relay_on_level = 1;
+    uint32_t key_min_ms = 20;
+    uint32_t qual_ms = 20;
+    uint32_t tail_s = 60;
+    uint32_t vcc_mv = 3300;
+    uint32_t baud = 115200;
+    double i_active_ua = 4000;
+    double i_idle_ua = 1500;
+    double i_pd_ua = 2;
+    double i_rail_ua = 2000;
+    double i_adc_ua = 300;
+    double i_float_ua = 20;
+    double i_backfeed_ua = 300;
+    double i_weak_ua = 50;
+    bool echo = false;
+    bool header = false;
+} opt;
+
+struct sim_end {};
+
+// 仿真状态
+static uint64_t now;
+static uint64_t next_deadline;
+static uint64_t end_cycles = NEVER;
+static uint8_t sfr[256];
+static uint8_t sfr_pins[PORT_COUNT];
+static int8_t ext[PORT_COUNT][8];
+static void (*isr_table[16])(void);
+static int isr_depth;
+static bool in_pd, in_idle;
+
+static uint64_t t0_next = NEVER;      // 定时器0下次溢出时刻
+static uint16_t t0_cnt, t0_reload;
+static uint64_t pca_anchor;           // PCA开始计数时刻
+static uint16_t pca_base;             // 开始计数时的计数值
+static uint64_t pca_match_at[3] = { NEVER, NEVER, NEVER };
+static uint64_t pca_ovf_at = NEVER;
+static uint8_t pca_ccap_l[3], pca_ccap_h[3];
+static uint64_t uart1_done = NEVER, uart2_done = NEVER;
+static bool iap_armed;
+static uint8_t eeprom[EEPROM_SIZE];
+
+static std::vector<trace_ev> trace;
+static size_t trace_pos;
+static bool pir, radar;
+static uint32_t vcc_mv;
+
+// 外部模型状态
+static bool rail;
+static uint8_t chan_on;               // 各通道开关位图
+static bool key_driven_low[CHAN_COUNT];
+static bool key_pressed[CHAN_COUNT];
+static uint64_t key_press_at[CHAN_COUNT];
+
+// 统计
+static uint64_t acc_last;
+static uint64_t cyc_active, cyc_idle, cyc_pd, cyc_rail, cyc_adc, cyc_lit;
+static double energy_nj, charge_uas, charge_pd_uas;
+static uint32_t n_wake_int, n_wake_wkt, n_wake_lvd, n_sessions, n_pulses, n_toggles, n_trace_sessions;
+static bool lat_pending;
+static uint64_t lat_start;
+static uint32_t lat_n, lat_missed;
+static uint64_t lat_sum, lat_max;
+
+static inline uint64_t ms_to_cycles(uint64_t ms) { return ms * MS_CYCLES; }
+static inline double cycles_to_ms(uint64_t c) { return (double)c * 1000.0 / FOSC; }
+
+/************************* 能耗积分 *************************/
+static inline bool pin_is(pin_ref r, int p, int b) { return r.port == p && r.bit == b; }
+
+// 引脚漏电（uA）：模块断电时Key线被HMBC09P保护二极管钳位到地（不悬空，输出高则倒灌）；
+// 其余无外部驱动的高阻/开漏高输入悬空，输入电平落在中间产生穿通电流
+static double pin_leak_ua(void)
+{
+    double ua = 0;
+
+    for(int p = 0; p < PORT_COUNT; p++)
+    {
+        uint8_t a = port_addr[p], latch = sfr[a], m1 = sfr[a + 1], m0 = sfr[a + 2];
+
+        for(int b = 0; b < 8; b++)
+        {
+            int mode = (((m1 >> b) & 1) << 1) | ((m0 >> b) & 1), l = (latch >> b) & 1;
+            bool key = false;
+
+            if(!((port_bonded[p] >> b) & 1))
+            {
+                continue;
+            }
+            for(int c = 0; c < CHAN_COUNT; c++)
+            {
+                key = key || pin_is(PIN_KEY[c], p, b);
+            }
+            if(key && !rail)
+            {
+                if(mode == 1 && l)
+                {
+                    ua += opt.i_backfeed_ua;
+                }
+                else if(mode == 0 && l)
+                {
+                    ua += opt.i_weak_ua;
+                }
+            }
+            else if(ext[p][b] == EXT_Z && (mode == 2 || (mode == 3 && l)))
+            {
+                ua += opt.i_float_ua;
+            }
+        }
+    }
+    return ua;
+}
+
+// 按当前状态累计上次积分以来的时间及能耗（任何影响电流的状态变化前调用）
+static void account(void)
+{
+    uint64_t dt = now - acc_last;
+    double ua;
+
+    if(dt == 0)
+    {
+        return;
+    }
+    acc_last = now;
+    if(in_pd)
+    {
+        cyc_pd += dt;
+        ua = opt.i_pd_ua;
+    }
+    else if(in_idle)
+    {
+        cyc_idle += dt;
+        ua = opt.i_idle_ua;
+    }
+    else
+    {
+        cyc_active += dt;
+        ua = opt.i_active_ua;
+    }
+    if(rail)
+    {
+        cyc_rail += dt;
+        ua += opt.i_rail_ua;
+    }
+    if(sfr[A_ADC_CONTR] & 0x80)
+    {
+        cyc_adc += dt;
+        ua += opt.i_adc_ua;
+    }
+    if(chan_on)
+    {
+        cyc_lit += dt;
+    }
+    ua += pin_leak_ua();
+    if(in_pd)
+    {
+        charge_pd_uas += ua * ((double)dt / FOSC);
+    }
+    charge_uas += ua * ((double)dt / FOSC);
+    energy_nj += ua * vcc_mv * ((double)dt / FOSC);  // uA * mV = nW
+}
+
+/************************* 端口 *************************/
+// 引脚电平：推挽=锁存；准双向=锁存0拉低，否则外部电平（未驱动时内部上拉为1）；
+// 高阻=外部电平（未驱动时按0）；开漏=锁存0拉低，否则外部电平（未驱动时按0）
+static uint8_t port_pins(int p)
+{
+    uint8_t a = port_addr[p], latch = sfr[a], m1 = sfr[a + 1], m0 = sfr[a + 2], v = 0;
+
+    for(int b = 0; b < 8; b++)
+    {
+        int mode = (((m1 >> b) & 1) << 1) | ((m0 >> b) & 1);
+        int l = (latch >> b) & 1, e = ext[p][b], lvl;
+
+        switch(mode)
+        {
+        case 1:  lvl = l; break;
+        case 0:  lvl = l ? (e == EXT_Z ? 1 : e) : 0; break;
+        case 2:  lvl = (e == EXT_Z) ? 0 : e; break;
+        default: lvl = l ? (e == EXT_Z ? 0 : e) : 0; break;
+        }
+        v |= (uint8_t)(lvl << b);
+    }
+    return v;
+}
+
+static inline int pin_level(pin_ref r) { return (sfr_pins[r.port] >> r.bit) & 1; }
+
+// 引脚被固件主动驱动为低（非高阻且锁存为0）
+static bool pin_driven_low(pin_ref r)
+{
+    uint8_t a = port_addr[r.port];
+    bool hz = ((sfr[a + 1] >> r.bit) & 1) && !((sfr[a + 2] >> r.bit) & 1);
+
+    return !hz && !((sfr[a] >> r.bit) & 1);
+}
+
+// 外部电平：PIR/雷达/HMBC09P（LED及继电器反馈）/电源开关（外部上下拉到关闭电平）/Key输入（HMBC09P上拉）
+static void ext_update(void)
+{
+    memset(ext, EXT_Z, sizeof(ext));
+    ext[PIN_PIR.port][PIN_PIR.bit] = pir;
+    ext[PIN_POWER.port][PIN_POWER.bit] = !opt.power_on_level;
+    if(rail)
+    {
+        ext[PIN_RADAR.port][PIN_RADAR.bit] = radar;
+        for(int c = 0; c < CHAN_COUNT; c++)
+        {
+            bool on = (chan_on >> c) & 1;
+
+            ext[PIN_KEY[c].port][PIN_KEY[c].bit] = 1;
+            ext[PIN_LED[c].port][PIN_LED[c].bit] = on ? opt.led_on_level : !opt.led_on_level;
+            ext[PIN_RELAY[c].port][PIN_RELAY[c].bit] = on ? opt.relay_on_level : !opt.relay_on_level;
+        }
+    }
+}
+
+static void chan_set(uint8_t on)
+{
+    if(on == chan_on)
+    {
+        return;
+    }
+    account();
+    if(!chan_on && on && lat_pending)
+    {
+        uint64_t l = now - lat_start;
+
+        lat_pending = false;
+        lat_n++;
+        lat_sum += l;
+        if(l > lat_max)
+        {
+            lat_max = l;
+        }
+    }
+    chan_on = on;
+}
+
+// 引脚或外部条件变化后重新计算：电源轨、HMBC09P按键、INT0/INT1边沿（外部反馈随之变化，迭代至稳定）
+static void world_update(void)
+{
+    for(int iter = 0; iter < 4; iter++)
+    {
+        uint8_t old_p3 = sfr_pins[PORT3];
+        bool changed = false;
+
+        ext_update();
+        for(int p = 0; p < PORT_COUNT; p++)
+        {
+            sfr_pins[p] = port_pins(p);
+        }
+
+        // INT0=P3.2，INT1=P3.3：IT=0双边沿，IT=1仅下降沿
+        for(int i = 0; i < 2; i++)
+        {
+            uint8_t m = (uint8_t)(1 << (2 + i));
+            bool was = old_p3 & m, is = sfr_pins[PORT3] & m;
+            uint8_t it = i ? 0x04 : 0x01, flag = i ? 0x08 : 0x02;
+
+            if(was != is && (!(sfr[A_TCON] & it) || !is))
+            {
+                sfr[A_TCON] |= flag;
+                next_deadline = now;
+            }
+        }
+
+        bool r = pin_level(PIN_POWER) == opt.power_on_level;
+        if(r != rail)
+        {
+            account();
+            rail = r;
+            if(rail)
+            {
+                n_sessions++;
+            }
+            else
+            {
+                chan_set(0);  // HMBC09P断电，全部通道关闭
+                memset(key_pressed, 0, sizeof(key_pressed));
+            }
+            changed = true;
+        }
+
+        for(int c = 0; c < CHAN_COUNT; c++)
+        {
+            bool low = pin_driven_low(PIN_KEY[c]);
+            bool pressed = rail && !pin_level(PIN_KEY[c]);
+
+            if(low && !key_driven_low[c])
+            {
+                n_pulses++;
+            }
+            key_driven_low[c] = low;
+            if(pressed && !key_pressed[c])
+            {
+                key_press_at[c] = now;
+            }
+            else if(!pressed && key_pressed[c] && now - key_press_at[c] >= ms_to_cycles(opt.key_min_ms))
+            {
+                n_toggles++;
+                chan_set(chan_on ^ (uint8_t)(1 << c));
+                changed = true;
+            }
+            key_pressed[c] = pressed;
+        }
+        if(!changed)
+        {
+            break;
+        }
+    }
+}
+
+/************************* 定时器0 / PCA *************************/
+static inline uint32_t t0_div(void) { return (sfr[A_AUXR] & 0x80) ? 1 : 12; }
+
+static uint16_t t0_count(void)
+{
+    uint64_t left;
+
+    if(t0_next == NEVER)
+    {
+        return t0_cnt;
+    }
+    left = (t0_next - now + t0_div() - 1) / t0_div();
+    return left >= 0x10000 ? 0 : (uint16_t)(0x10000 - left);
+}
+
+static uint32_t pca_div(void)
+{
+    static const uint8_t div[8] = { 12, 2, 12, 12, 1, 4, 6, 8 };  // CPS=010/011（T0溢出/ECI）按12分频
+
+    return div[(sfr[A_CMOD] >> 1) & 0x07];
+}
+
+static uint16_t pca_count(void)
+{
+    if(!(sfr[A_CCON] & 0x40))
+    {
+        return pca_base;
+    }
+    return (uint16_t)(pca_base + (now - pca_anchor) / pca_div());
+}
+
+// 以当前时刻为计数起点（运行状态、分频或计数值变化前调用）
+static void pca_rebase(void)
+{
+    pca_base = pca_count();
+    pca_anchor = now;
+}
+
+// 比较匹配/溢出时刻按当前计数重新计算（计数、比较值、模式或运行状态变化后调用）
+static void pca_schedule(void)
+{
+    uint16_t cnt;
+    uint64_t div = pca_div();
+
+    pca_rebase();
+    cnt = pca_base;
+    pca_ovf_at = NEVER;
+    for(int n = 0; n < 3; n++)
+    {
+        pca_match_at[n] = NEVER;
+    }
+    if(!(sfr[A_CCON] & 0x40))
+    {
+        return;
+    }
+    pca_ovf_at = now + (0x10000 - cnt) * div;
+    for(int n = 0; n < 3; n++)
+    {
+        if((sfr[A_CCAPM0 + n] & 0x48) == 0x48)  // ECOM | MAT
+        {
+            uint32_t d = (uint16_t)((((uint16_t)pca_ccap_h[n] << 8) | pca_ccap_l[n]) - cnt);
+
+            pca_match_at[n] = now + (d ? d : 0x10000) * div;
+        }
+    }
+    next_deadline = now;
+}
+
+/************************* 外设事件 *************************/
+static void lvd_check(void)
+{
+    static const uint16_t lvd_mv[4] = { 2000, 2400, 2700, 3000 };
+
+    if(vcc_mv < lvd_mv[sfr[A_RSTCFG] & 0x03])
+    {
+        sfr[A_PCON] |= 0x20;
+    }
+}
+
+static void trace_apply(const trace_ev &e)
+{
+    switch(e.type)
+    {
+    case EV_PIR:
+        if(e.val && !pir && e.tag != PIR_SPURIOUS)
+        {
+            if(e.tag == PIR_SESSION && lat_pending)
+            {
+                lat_missed++;  // 上一轮有人未开灯
+                lat_pending = false;
+            }
+            if(!chan_on && !lat_pending)
+            {
+                lat_pending = true;
+                lat_start = now;
+            }
+        }
+        pir = e.val;
+        break;
+    case EV_RADAR:
+        radar = e.val;
+        break;
+    case EV_VCC:
+        account();
+        vcc_mv = e.val;
+        break;
+    }
+    world_update();
+    lvd_check();
+}
+
+static void uart_out(uint8_t c)
+{
+    if(opt.echo)
+    {
+        fputc(c, stderr);
+    }
+}
+
+// 处理当前时刻之前到期的全部外设事件（不派发中断）
+static void process_due(void)
+{
+    if(now >= end_cycles)
+    {
+        throw sim_end();
+    }
+    while(t0_next <= now)
+    {
+        sfr[A_TCON] |= 0x20;  // TF0，计数自动重载
+        t0_next += (uint64_t)(0x10000 - t0_reload) * t0_div();
+    }
+    for(int n = 0; n < 3; n++)
+    {
+        while(pca_match_at[n] <= now)
+        {
+            sfr[A_CCON] |= (uint8_t)(1 << n);
+            pca_match_at[n] += 0x10000ULL * pca_div();
+        }
+    }
+    while(pca_ovf_at <= now)
+    {
+        sfr[A_CCON] |= 0x80;
+        pca_ovf_at += 0x10000ULL * pca_div();
+    }
+    if(uart1_done <= now)
+    {
+        sfr[A_SCON] |= 0x02;
+        uart1_done = NEVER;
+    }
+    if(uart2_done <= now)
+    {
+        sfr[A_S2CON] |= 0x02;
+        uart2_done = NEVER;
+    }
+    while(trace_pos < trace.size() && trace[trace_pos].t <= now)
+    {
+        trace_apply(trace[trace_pos++]);
+    }
+    lvd_check();
+}
+
+static uint64_t next_event(bool pd)
+{
+    uint64_t t = end_cycles;
+
+    if(trace_pos < trace.size() && trace[trace_pos].t < t)
+    {
+        t = trace[trace_pos].t;
+    }
+    if(pd)
+    {
+        return t;
+    }
+    uint64_t c[] = { t0_next, pca_match_at[0], pca_match_at[1], pca_match_at[2], pca_ovf_at, uart1_done, uart2_done };
+    for(uint64_t x : c)
+    {
+        if(x < t)
+        {
+            t = x;
+        }
+    }
+    return t;
+}
+
+/************************* 中断 *************************/
+// 中断请求（不含EA）：按自然优先级顺序，返回向量号，无则-1
+static int irq_pending(void)
+{
+    uint8_t ie = sfr[A_IE], tcon = sfr[A_TCON], ccon = sfr[A_CCON];
+
+    if((tcon & 0x02) && (ie & 0x01)) return 0;
+    if((tcon & 0x20) && (ie & 0x02)) return 1;
+    if((tcon & 0x08) && (ie & 0x04)) return 2;
+    if((sfr[A_SCON] & 0x03) && (ie & 0x10)) return 4;
+    if((sfr[A_PCON] & 0x20) && (ie & 0x40)) return 6;
+    if(((ccon & 0x80) && (sfr[A_CMOD] & 0x01)) || ((ccon & 0x01) && (sfr[A_CCAPM0] & 0x01)) ||
+       ((ccon & 0x02) && (sfr[A_CCAPM0 + 1] & 0x01)) || ((ccon & 0x04) && (sfr[A_CCAPM0 + 2] & 0x01)))
+    {
+        return 7;
+    }
+    if((sfr[A_S2CON] & 0x03) && (sfr[A_IE2] & 0x01)) return 8;
+    return -1;
+}
+
+static void dispatch(void)
+{
+    int v;
+
+    if(isr_depth || !(sfr[A_IE] & 0x80) || (v = irq_pending()) < 0 || !isr_table[v])
+    {
+        return;
+    }
+    switch(v)  // 外部中断/定时器0进入中断时硬件清除标志
+    {
+    case 0: sfr[A_TCON] &= ~0x02; break;
+    case 1: sfr[A_TCON] &= ~0x20; break;
+    case 2: sfr[A_TCON] &= ~0x08; break;
+    }
+    isr_depth++;
+    isr_table[v]();
+    isr_depth--;
+    next_deadline = now;
+}
+
+static void service(void)
+{
+    process_due();
+    next_deadline = next_event(false);
+    dispatch();
+}
+
+/************************* 掉电 / 空闲 *************************/
+static bool wake_pending(void)
+{
+    uint8_t ie = sfr[A_IE], tcon = sfr[A_TCON];
+
+    return ((tcon & 0x08) && (ie & 0x04)) || ((tcon & 0x02) && (ie & 0x01)) ||
+           ((sfr[A_PCON] & 0x20) && (ie & 0x40));
+}
+
+// 掉电：时钟停止（定时器/PCA/串口时刻整体后移），跳到下一个输入事件或唤醒定时器
+static void power_down(void)
+{
+    uint64_t wkt_at = NEVER;
+    bool by_wkt = false;
+
+    process_due();
+    account();
+    in_pd = true;
+    if(sfr[A_WKTCH] & 0x80)
+    {
+        uint64_t count = (((uint64_t)(sfr[A_WKTCH] & 0x7F) << 8) | sfr[A_WKTCL]) + 1;
+
+        wkt_at = now + count * WKT_TICK_NS * FOSC / 1000000000ULL;
+    }
+    while(!wake_pending())
+    {
+        uint64_t t = next_event(true), dt;
+
+        if(wkt_at < t)
+        {
+            t = wkt_at;
+        }
+        dt = t - now;
+        now = t;
+        uint64_t *frozen[] = { &t0_next, &pca_anchor, &pca_match_at[0], &pca_match_at[1], &pca_match_at[2],
+                               &pca_ovf_at, &uart1_done, &uart2_done };
+        for(uint64_t *p : frozen)
+        {
+            if(*p != NEVER)
+            {
+                *p += dt;
+            }
+        }
+        if(now >= end_cycles)
+        {
+            account();
+            throw sim_end();
+        }
+        if(now == wkt_at)
+        {
+            by_wkt = true;
+            break;
+        }
+        while(trace_pos < trace.size() && trace[trace_pos].t <= now)
+        {
+            trace_apply(trace[trace_pos++]);
+        }
+        lvd_check();
+    }
+    if(by_wkt)
+    {
+        n_wake_wkt++;
+    }
+    else if((sfr[A_TCON] & 0x08 && sfr[A_IE] & 0x04) || (sfr[A_TCON] & 0x02 && sfr[A_IE] & 0x01))
+    {
+        n_wake_int++;
+    }
+    else
+    {
+        n_wake_lvd++;
+    }
+    account();
+    in_pd = false;
+    sfr[A_PCON] &= ~0x02;
+    next_deadline = now;
+}
+
+// 空闲：CPU停止，外设继续运行，等待任一已允许的中断
+static void idle(void)
+{
+    account();
+    in_idle = true;
+    for(;;)
+    {
+        process_due();
+        if((sfr[A_IE] & 0x80) && irq_pending() >= 0)
+        {
+            break;
+        }
+        now = next_event(false);
+    }
+    account();
+    in_idle = false;
+    sfr[A_PCON] &= ~0x01;
+    next_deadline = now;
+}
+
+/************************* ADC / IAP *************************/
+static void adc_start(void)
+{
+    uint16_t v = 0;
+
+    if((sfr[A_ADC_CONTR] & 0x0F) == 0x0F && vcc_mv)
+    {
+        v = (uint16_t)(1190UL * 4096 / vcc_mv);  // CH15：内部1.19V参考
+        if(v > 4095)
+        {
+            v = 4095;
+        }
+    }
+    sfr[A_ADC_RES] = (uint8_t)(v >> 4);
+    sfr[A_ADC_RESL] = (uint8_t)(v & 0x0F);
+    sfr[A_ADC_CONTR] = (uint8_t)((sfr[A_ADC_CONTR] & ~0x40) | 0x20);
+}
+
+static void iap_trigger(void)
+{
+    uint16_t addr = (uint16_t)(((sfr[A_IAP_ADDRH] << 8) | sfr[A_IAP_ADDRL]) % EEPROM_SIZE);
+
+    if(!(sfr[A_IAP_CONTR] & 0x80))
+    {
+        return;
+    }
+    switch(sfr[A_IAP_CMD] & 0x03)
+    {
+    case 1:
+        sfr[A_IAP_DATA] = eeprom[addr];
+        break;
+    case 2:
+        eeprom[addr] &= sfr[A_IAP_DATA];
+        now += IAP_WRITE_US * (FOSC / 1000000);
+        break;
+    case 3:
+        memset(&eeprom[addr & ~(EEPROM_SECTOR - 1)], 0xFF, EEPROM_SECTOR);
+        now += IAP_ERASE_US * (FOSC / 1000000);
+        break;
+    }
+}
+
+/************************* 固件接口 *************************/
+uint8_t host_sfr_latch(uint8_t addr)
+{
+    switch(addr)
+    {
+    case A_TL0: return (uint8_t)t0_count();
+    case A_TH0: return (uint8_t)(t0_count() >> 8);
+    case A_CL:  return (uint8_t)pca_count();
+    case A_CH:  return (uint8_t)(pca_count() >> 8);
+    }
+    if(addr >= A_CCAP0L && addr < A_CCAP0L + 3) return pca_ccap_l[addr - A_CCAP0L];
+    if(addr >= A_CCAP0H && addr < A_CCAP0H + 3) return pca_ccap_h[addr - A_CCAP0H];
+    return sfr[addr];
+}
+
+uint8_t host_sfr_read(uint8_t addr)
+{
+    switch(addr)
+    {
+    case A_P1: return sfr_pins[PORT1];
+    case A_P3: return sfr_pins[PORT3];
+    case A_P5: return sfr_pins[PORT5];
+    }
+    return host_sfr_latch(addr);
+}
+
+void host_sfr_write(uint8_t addr, uint8_t val)
+{
+    uint8_t old = sfr[addr];
+
+    next_deadline = now;  // 写寄存器可能使能中断或产生事件，下一个基本块重新检查
+    if(addr >= A_CCAP0L && addr < A_CCAP0L + 3)
+    {
+        pca_ccap_l[addr - A_CCAP0L] = val;
+        sfr[A_CCAPM0 + addr - A_CCAP0L] &= ~0x40;  // 写CCAPnL清ECOM
+        pca_schedule();
+        return;
+    }
+    if(addr >= A_CCAP0H && addr < A_CCAP0H + 3)
+    {
+        pca_ccap_h[addr - A_CCAP0H] = val;
+        sfr[A_CCAPM0 + addr - A_CCAP0H] |= 0x40;   // 写CCAPnH置ECOM
+        pca_schedule();
+        return;
+    }
+    switch(addr)
+    {
+    case A_TL0:
+    case A_TH0:
+        if(addr == A_TL0)
+        {
+            t0_reload = (uint16_t)((t0_reload & 0xFF00) | val);
+        }
+        else
+        {
+            t0_reload = (uint16_t)((t0_reload & 0x00FF) | (val << 8));
+        }
+        if(t0_next == NEVER)
+        {
+            t0_cnt = t0_reload;  // 停止时同时写入计数器
+        }
+        return;
+    case A_CL:
+    case A_CH:
+        pca_rebase();
+        pca_base = (addr == A_CL) ? (uint16_t)((pca_base & 0xFF00) | val) : (uint16_t)((pca_base & 0x00FF) | (val << 8));
+        pca_schedule();
+        return;
+    case A_SBUF:
+        uart_out(val);
+        uart1_done = now + 10 * FOSC / opt.baud;
+        return;
+    case A_S2BUF:
+        uart_out(val);
+        uart2_done = now + 10 * FOSC / opt.baud;
+        return;
+    case A_IAP_TRIG:
+        if(val == 0x5A)
+        {
+            iap_armed = true;
+        }
+        else
+        {
+            if(val == 0xA5 && iap_armed)
+            {
+                iap_trigger();
+            }
+            iap_armed = false;
+        }
+        return;
+    }
+
+    if(addr == A_ADC_CONTR || addr == A_P1 || addr == A_P1M1 || addr == A_P1M0 || addr == A_P3 ||
+       addr == A_P3M1 || addr == A_P3M0 || addr == A_P5 || addr == A_P5M1 || addr == A_P5M0)
+    {
+        account();
+    }
+    if(addr == A_CCON || addr == A_CMOD)
+    {
+        pca_rebase();
+    }
+    sfr[addr] = val;
+    switch(addr)
+    {
+    case A_P1: case A_P1M1: case A_P1M0:
+    case A_P3: case A_P3M1: case A_P3M0:
+    case A_P5: case A_P5M1: case A_P5M0:
+        world_update();
+        break;
+    case A_TCON:
+        if((val ^ old) & 0x10)
+        {
+            if(val & 0x10)
+            {
+                t0_next = now + (uint64_t)(0x10000 - t0_cnt) * t0_div();
+            }
+            else
+            {
+                t0_cnt = t0_count();
+                t0_next = NEVER;
+            }
+        }
+        if((val ^ old) & 0x05)
+        {
+            world_update();
+        }
+        break;
+    case A_CCON:
+    case A_CMOD:
+    case A_CCAPM0: case A_CCAPM0 + 1: case A_CCAPM0 + 2:
+        pca_schedule();
+        break;
+    case A_ADC_CONTR:
+        if((val & 0xC0) == 0xC0)
+        {
+            adc_start();
+        }
+        break;
+    case A_PCON:
+        if(val & 0x02)
+        {
+            power_down();
+        }
+        else if(val & 0x01)
+        {
+            idle();
+        }
+        break;
+    case A_RSTCFG:
+        lvd_check();
+        break;
+    }
+}
+
+void host_cycles(uint32_t n)
+{
+    now += n;
+    if(now >= next_deadline)
+    {
+        service();
+    }
+}
+
+void host_isr_register(uint8_t vector, void (*isr)(void))
+{
+    if(vector < 16)
+    {
+        isr_table[vector] = isr;
+    }
+}
+
+// 固件按-fsanitize-coverage=trace-pc编译：每个基本块入口调用一次
+extern "C" void __sanitizer_cov_trace_pc(void)
+{
+    host_cycles(opt.bb_cycles);
+}
+
+/************************* 轨迹解析 *************************/
+// 只取“W/E/V <数> <数>”行，其余行（TLM遥测、D丢弃计数、注释）忽略
+static bool trace_load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[256];
+    uint64_t base = 0, last = 0;
+    bool p = false;
+
+    if(!f)
+    {
+        perror(path);
+        return false;
+    }
+    auto push = [&](uint64_t t_ms, uint8_t type, uint8_t tag, uint16_t val)
+    {
+        if(t_ms < last)
+        {
+            t_ms = last;  // W记录按秒计，保证事件时间单调
+        }
+        last = t_ms;
+        trace.push_back({ ms_to_cycles(t_ms), type, tag, val });
+    };
+    while(fgets(line, sizeof(line), f))
+    {
+        char type;
+        unsigned long a, b;
+
+        if(sscanf(line, "%c %lu %lu", &type, &a, &b) != 3 || (line[1] != ' '))
+        {
+            continue;
+        }
+        switch(type)
+        {
+        case 'W':
+            base = a * 1000;
+            if(base < last)
+            {
+                base = last;
+            }
+            if(p)
+            {
+                push(base, EV_PIR, PIR_INSESSION, 0);  // 保证唤醒为上升沿
+                base++;
+            }
+            if(b)
+            {
+                n_trace_sessions++;
+                push(base, EV_PIR, PIR_SESSION, 1);
+                base += opt.qual_ms;  // E/V记录以唤醒确认时刻为基准
+                p = true;
+            }
+            else
+            {
+                push(base, EV_PIR, PIR_SPURIOUS, 1);
+                push(base + 1, EV_PIR, PIR_SPURIOUS, 0);
+                p = false;
+            }
+            break;
+        case 'E':
+            if((b & 1) != p)
+            {
+                p = b & 1;
+                push(base + a, EV_PIR, PIR_INSESSION, p);
+            }
+            push(base + a, EV_RADAR, 0, (b >> 1) & 1);
+            break;
+        case 'V':
+            push(base + a, EV_VCC, 0, (uint16_t)b);
+            break;
+        }
+    }
+    fclose(f);
+    end_cycles = ms_to_cycles(last + (uint64_t)opt.tail_s * 1000);
+    return true;
+}
+
+/************************* 主程序 *************************/
+static void usage(void)
+{
+    fprintf(stderr,
+            "用法：replay_<版本> [选项] <轨迹文件>\n"
+            "  --name S            报告中的版本名\n"
+            "  --header            先输出表头\n"
+            "  --bb-cycles N       每个基本块的时钟数（默认3）\n"
+            "  --power-on-level N  P5.5打开电源的电平（默认0）\n"
+            "  --led-on-level N    HMBC09P通道打开时LED反馈电平（默认0）\n"
+            "  --relay-on-level N  通道打开时继电器反馈电平（默认1）\n"
+            "  --key-min-ms N      HMBC09P识别按键的最短按下时间（默认20）\n"
+            "  --qual-ms N         确认唤醒记录相对PIR上升沿的延迟（默认20）\n"
+            "  --tail-s N          最后一个事件后继续运行的秒数（默认60）\n"
+            "  --vcc N             首条V记录之前的电压mV（默认3300）\n"
+            "  --i-active-ua X --i-idle-ua X --i-pd-ua X --i-rail-ua X --i-adc-ua X  电流假设（uA）\n"
+            "  --i-float-ua X --i-backfeed-ua X --i-weak-ua X  每脚漏电假设（uA）：悬空输入/推挽倒灌/准双向弱上拉\n"
+            "  --echo              串口输出回显到stderr\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if(!strcmp(a, "--header")) { opt.header = true; continue; }
+        if(!strcmp(a, "--echo")) { opt.echo = true; continue; }
+        if(a[0] != '-')
+        {
+            path = a;
+            continue;
+        }
+        if(!v)
+        {
+            usage();
+        }
+        i++;
+        if(!strcmp(a, "--name")) opt.name = v;
+        else if(!strcmp(a, "--bb-cycles")) opt.bb_cycles = (uint32_t)atoi(v);
+        else if(!strcmp(a, "--power-on-level")) opt.power_on_level = atoi(v) != 0;
+        else if(!strcmp(a, "--led-on-level")) opt.led_on_level = atoi(v) != 0;
+        else if(!strcmp(a, "--relay-on-level")) opt.relay_on_level = atoi(v) != 0;
+        else if(!strcmp(a, "--key-min-ms")) opt.key_min_ms = (uint32_t)atoi(v);
+        else if(!strcmp(a, "--qual-ms")) opt.qual_ms = (uint32_t)atoi(v);
+        else if(!strcmp(a, "--tail-s")) opt.tail_s = (uint32_t)atoi(v);
+        else if(!strcmp(a, "--vcc")) opt.vcc_mv = (uint32_t)atoi(v);
+        else if(!strcmp(a, "--i-active-ua")) opt.i_active_ua = atof(v);
+        else if(!strcmp(a, "--i-idle-ua")) opt.i_idle_ua = atof(v);
+        else if(!strcmp(a, "--i-pd-ua")) opt.i_pd_ua = atof(v);
+        else if(!strcmp(a, "--i-rail-ua")) opt.i_rail_ua = atof(v);
+        else if(!strcmp(a, "--i-adc-ua")) opt.i_adc_ua = atof(v);
+        else if(!strcmp(a, "--i-float-ua")) opt.i_float_ua = atof(v);
+        else if(!strcmp(a, "--i-backfeed-ua")) opt.i_backfeed_ua = atof(v);
+        else if(!strcmp(a, "--i-weak-ua")) opt.i_weak_ua = atof(v);
+        else usage();
+    }
+    if(!path || !trace_load(path))
+    {
+        usage();
+    }
+
+    // 复位状态：端口锁存1、全部高阻（P3.0/P3.1准双向），上电复位标志POF
+    vcc_mv = opt.vcc_mv;
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    sfr[A_P1] = sfr[A_P3] = sfr[A_P5] = 0xFF;
+    sfr[A_P1M1] = sfr[A_P5M1] = 0xFF;
+    sfr[A_P3M1] = 0xFC;
+    sfr[A_PCON] = 0x10;
+    world_update();
+
+    try
+    {
+        fw_main();
+    }
+    catch(const sim_end &)
+    {
+    }
+    now = end_cycles;
+    account();
+    if(lat_pending)
+    {
+        lat_missed++;
+    }
+
+    double total_s = (double)now / FOSC;
+    if(opt.header)
+    {
+        printf("%-14s %6s %6s %6s %6s %7s %7s %10s %10s %10s %9s %8s %8s %5s %8s %8s %6s\n",
+               "variant", "trace", "wake", "wkt", "lvd", "rail_on", "pulses", "active_ms", "rail_ms", "lit_s",
+               "energy_mJ", "avg_uA", "sleep_uA", "lat_n", "lat_avg", "lat_max", "missed");
+    }
+    printf("%-14s %6u %6u %6u %6u %7u %7u %10.0f %10.0f %10.1f %9.2f %8.1f %8.1f %5u %8.0f %8.0f %6u\n",
+           opt.name, n_trace_sessions, n_wake_int, n_wake_wkt, n_wake_lvd, n_sessions, n_pulses,
+           cycles_to_ms(cyc_active + cyc_idle), cycles_to_ms(cyc_rail), cycles_to_ms(cyc_lit) / 1000.0,
+           energy_nj / 1e6, charge_uas / total_s, cyc_pd ? charge_pd_uas / ((double)cyc_pd / FOSC) : 0.0, lat_n,
+           lat_n ? cycles_to_ms(lat_sum) / lat_n : 0.0, cycles_to_ms(lat_max), lat_missed);
+    return 0;
+}